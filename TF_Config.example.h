@@ -53,9 +53,34 @@ typedef uint8_t TF_COUNT;
 // Maximum received payload size (static buffer)
 // Larger payloads will be rejected.
 #define TF_MAX_PAYLOAD_RX 1024
+// Lease the receive buffer from a pool shared by all instances instead of
+// embedding TF_MAX_PAYLOAD_RX bytes in each TinyFrame struct. A buffer is taken
+// when a frame header validates and returned after the frame is dispatched,
+// so memory scales with the number of frames being received at once.
+#define TF_USE_RX_POOL    0
+// Number of TF_MAX_PAYLOAD_RX-sized buffers in the pool (if TF_USE_RX_POOL == 1)
+#define TF_RX_POOL_SLABS  8
+// Queue received frames instead of running listeners inside TF_Accept().
+// TF_Dispatch() then runs them from a separate thread (woken by TF_NotifyDispatch()),
+// while the parser keeps filling the next buffer. Requires TF_USE_RX_POOL; the pool
+// should hold at least TF_RX_QUEUE_LEN + 1 buffers per instance.
+#define TF_USE_RX_QUEUE   0
+// Number of queued frames per lane, a power of two (if TF_USE_RX_QUEUE == 1)
+#define TF_RX_QUEUE_LEN   4
+// Number of dispatch lanes. Frames go to lane (type % TF_DISPATCH_LANES), each lane
+// is drained by one worker thread calling TF_DispatchLane(), so frames of one type
+// stay in order and different types run in parallel. More than one lane requires
+// TF_USE_REGISTRY_LOCK.
+#define TF_DISPATCH_LANES 1
 // Size of the sending buffer. Larger payloads will be split to pieces and sent
 // in multiple calls to the write function. This can be lowered to reduce RAM usage.
 #define TF_SENDBUF_LEN    128
+// Compose frames in a scratch buffer shared per thread (TF_THREAD_LOCAL, defaults
+// to __thread) instead of a sendbuf inside each instance. Define TF_THREAD_LOCAL
+// as empty if a single event loop thread drives all instances. With a shared
+// buffer, TF_SENDBUF_LEN can be made much larger without multiplying it by the
+// number of instances.
+#define TF_USE_SHARED_SENDBUF 0
 
 // --- Listener counts - determine sizes of the static slot tables ---
 
@@ -66,6 +91,15 @@ typedef uint8_t TF_COUNT;
 // Generic listeners (fallback if no other listener catches it)
 #define TF_MAX_GEN_LST  5
 
+// Shared listener templates: build a frozen set of type/generic listeners once
+// (TF_TemplateAdd*Listener, TF_TemplateFreeze) and attach it by reference to
+// many instances with TF_InitFromTemplate(). The instance tables above then only
+// need room for per-instance overrides.
+#define TF_USE_LISTENER_TEMPLATE 0
+// Capacity of a template (if TF_USE_LISTENER_TEMPLATE == 1)
+#define TF_MAX_TEMPLATE_TYPE_LST 256
+#define TF_MAX_TEMPLATE_GEN_LST  2
+
 // Timeout for receiving & parsing a frame
 // ticks = number of calls to TF_Tick()
 #define TF_PARSER_TIMEOUT_TICKS 10
@@ -73,7 +107,81 @@ typedef uint8_t TF_COUNT;
 // Whether to use mutex - requires you to implement TF_ClaimTx() and TF_ReleaseTx()
 #define TF_USE_MUTEX  1
 
-// Error reporting function. To disable debug, change to empty define
+// Protect the listener tables with a lock - requires you to implement
+// TF_ClaimRegistry() and TF_ReleaseRegistry(). Needed when listeners run on
+// more than one thread, or are added/removed while another thread dispatches.
+#define TF_USE_REGISTRY_LOCK 0
+
+// Dispatch through the type and generic listener tables without taking the
+// registry lock. Writers (add/remove, serialized by the registry lock) update a
+// second copy of the tables and publish it atomically; the old copy is reused
+// once the readers still scanning it have left (grace period). Handlers can be
+// swapped at runtime without pausing RX. Doubles the size of these tables.
+// Requires TF_USE_REGISTRY_LOCK. ID listeners still use the lock.
+#define TF_USE_RCU_LISTENERS 0
+
+// Let one thread receive (TF_Accept) while other threads send and tick. The
+// parser state, the TX state and the listener tables are kept apart, and a
+// concurrent second call to TF_Accept() is reported and dropped instead of
+// corrupting the parser. Requires TF_USE_MUTEX and TF_USE_REGISTRY_LOCK.
+#define TF_FULL_DUPLEX 0
+
+// Cache line size used to place the RX state, TX state and listener tables of
+// an instance on separate lines, so the RX and TX threads don't slow each other
+// down by writing to the same line. 0 = don't align (saves RAM on small targets).
+#define TF_CACHE_LINE 0
+
+// Keep per-instance counters (frames, bytes, checksum errors, timeouts,
+// listener hits/misses, ...) readable with TF_GetStats(). Each counter is a
+// plain increment on the path where the event happens, so the link quality
+// can be monitored with TF_Error disabled.
+#define TF_USE_STATS 0
+
+// Mirror every validated RX frame and every sent TX frame (timestamp,
+// direction, id, type, len and up to TF_CAPTURE_SNAPLEN payload bytes) into a
+// lock-free TF_CaptureRing attached with TF_SetCapture(). Another thread drains
+// it with TF_CaptureRead(). Requires TF_Timestamp(). TF_CAPTURE_SLOTS must
+// be a power of 2.
+#define TF_USE_CAPTURE     0
+#define TF_CAPTURE_SLOTS   64
+#define TF_CAPTURE_SNAPLEN 64
+
+// Record the round-trip latency of every query (from the start of TF_Query(),
+// including the wait in TF_ClaimTx(), to the response's ID listener callback
+// or the listener timeout) in a log-linear histogram per query type. Read
+// p50/p90/p99/p99.9 with TF_GetLatency(). Requires TF_Timestamp().
+// TF_LATENCY_TYPES histograms of about 2 KiB each are kept per instance.
+#define TF_USE_LATENCY      0
+#define TF_LATENCY_TYPES    8
+#define TF_LATENCY_SUB_BITS 4  // 2^4 buckets per power of 2 = values within 1/16
+#define TF_LATENCY_MAX_BITS 36 // values up to 2^36 timestamp units (~68 s in ns)
+
+// Stamp received messages with TF_Timestamp() when the first byte of the frame
+// (SOF) is parsed and when the checksum passes (msg->rx_start, msg->rx_end),
+// to tell the time on the wire apart from the time waiting for dispatch.
+#define TF_USE_RX_TIMESTAMP 0
+
+// Trace points at the frame lifecycle (frame_begin, frame_header,
+// frame_complete, dispatch_begin/end, tx_claim_begin/end, tx_flush_begin/end,
+// id_listener_expire; see TinyFrame.h for the arguments). With TF_USE_USDT 1
+// they become USDT probes of provider "tinyframe" (needs <sys/sdt.h>) that
+// perf and bpftrace can attach to. Alternatively define your own macro, e.g.
+//   #define TF_TRACE(probe, ...) tracepoint(tinyframe, probe, ##__VA_ARGS__)
+// By default the trace points compile to nothing.
+#define TF_USE_USDT 0
+
+// Report library errors through a callback registered with
+// TF_SetErrorCallback() instead of TF_Error(). The callback receives an error
+// code and numeric arguments (no formatting in the library), and each code is
+// limited to TF_ERROR_BURST reports per TF_ERROR_WINDOW_TICKS ticks per
+// instance; the rest are only counted. Keeps line noise from slowing the
+// parser down with log output.
+#define TF_USE_ERROR_CALLBACK 0
+#define TF_ERROR_BURST        5
+#define TF_ERROR_WINDOW_TICKS 1000
+
+// Error reporting function, used when TF_USE_ERROR_CALLBACK is 0 (and by the
+// utilities). To disable debug, change to empty define
 #define TF_Error(format, ...) printf("[TF] " format "\n", ##__VA_ARGS__)
 
 //------------------------- End of user config ------------------------------
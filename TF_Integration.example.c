@@ -32,6 +32,65 @@ void TF_ReleaseTx(TinyFrame *tf)
     // release mutex
 }
 
+// --------- Registry lock callbacks ----------
+// Needed only if TF_USE_REGISTRY_LOCK is 1 in the config file.
+// No user code (listeners, the error callback, TF_Timestamp(), trace points)
+// is called while the lock is held, so a non-recursive mutex is fine.
+
+/** Claim the listener tables */
+void TF_ClaimRegistry(TinyFrame *tf)
+{
+    // take mutex
+}
+
+/** Free the listener tables */
+void TF_ReleaseRegistry(TinyFrame *tf)
+{
+    // release mutex
+}
+
+// --------- Dispatch notification ----------
+// Needed only if TF_USE_RX_QUEUE is 1 in the config file.
+
+/** A frame was queued on a lane - wake the thread that calls TF_DispatchLane(tf, lane) */
+void TF_NotifyDispatch(TinyFrame *tf, uint32_t lane)
+{
+    // post semaphore
+}
+
+// --------- Error callback ---------
+// Used only if TF_USE_ERROR_CALLBACK is 1 in the config file.
+// DELETE this and the TF_SetErrorCallback() call below if not used.
+
+/**
+ * Called for rate-limited library errors, without the registry lock held -
+ * adding or removing listeners here is fine. Some errors are reported from
+ * inside a send with the TX lock held, so do not send on the same instance.
+ */
+static void tf_on_error(TinyFrame *tf, TF_ErrorCode code, uint32_t arg1, uint32_t arg2, uint32_t suppressed)
+{
+    // e.g. log TF_ErrorName(code), arg1, arg2 and suppressed to a ring buffer
+}
+
+// --------- Startup ---------
+
+/** Set up the instance once at startup, before the UART interrupt is enabled */
+void app_tf_init(TinyFrame *tf)
+{
+    TF_SetErrorCallback(tf_on_error); // shared by all instances
+    TF_InitStatic(tf, TF_MASTER);
+    // add type and generic listeners here
+}
+
+// --------- Timestamp ---------
+// Needed only if TF_USE_CAPTURE, TF_USE_LATENCY or TF_USE_RX_TIMESTAMP is 1 in the config file.
+
+/** Monotonic timestamp for capture records, query latency and RX timestamps, called once or twice per frame */
+uint64_t TF_Timestamp(void)
+{
+    return 0; // e.g. clock_gettime(CLOCK_MONOTONIC) in ns, or a cycle counter
+}
+
 // --------- Custom checksums ---------
 // This should be defined here only if a custom checksum type is used.
 // DELETE those if you use one of the built-in checksum types
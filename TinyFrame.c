@@ -1,6 +1,9 @@
 //---------------------------------------------------------------------------
 #include "TinyFrame.h"
 #include <stdlib.h> // - 如果使用动态构造函数，则需要 malloc()
+#if TF_USE_USDT
+#include <sys/sdt.h> // - USDT 跟踪点
+#endif
 //---------------------------------------------------------------------------
 
 // 兼容 ESP8266 SDK
@@ -15,6 +18,27 @@
 #define TF_MIN(a, b) ((a)<(b)?(a):(b))
 #define TF_TRY(func) do { if(!(func)) return false; } while (0)
 
+// 在线程之间共享的字段使用宽松的原子访问（编译为普通的读写，但没有数据竞争）
+#define TF_LOAD_RELAXED(var)       __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define TF_STORE_RELAXED(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+
+#if TF_USE_STATS
+    // 统计计数器：每个计数器只有一个写者，普通的（非锁定的）递增；TF_GetStats() 可以在其他线程中读取
+    #define TF_STAT_ADD(var, n) TF_STORE_RELAXED(var, (uint32_t) (TF_LOAD_RELAXED(var) + (n)))
+#else
+    #define TF_STAT_ADD(var, n) do { } while (0)
+#endif
+#define TF_STAT_INC(var) TF_STAT_ADD(var, 1)
+
+#if TF_USE_ERROR_CALLBACK
+    static void tf_report_error(TinyFrame *tf, TF_ErrorCode code, uint32_t arg1, uint32_t arg2);
+
+    // 只把错误码和数字参数交给回调，消息和格式参数被丢弃
+    #define TF_REPORT(tf, code, arg1, arg2, ...) tf_report_error((tf), (code), (uint32_t) (arg1), (uint32_t) (arg2))
+#else
+    #define TF_REPORT(tf, code, arg1, arg2, ...) TF_Error(__VA_ARGS__)
+#endif
+
 
 // 类型相关的掩码，用于 ID 字段中的位操作
 #define TF_ID_MASK (TF_ID)(((TF_ID)1 << (sizeof(TF_ID)*8 - 1)) - 1)
@@ -28,19 +52,19 @@
 
     /** 声明** TX 接口，在组合和发送帧之前 */
     static bool TF_ClaimTx(TinyFrame *tf) {
-        if (tf->soft_lock) {
-            TF_Error("TF 已锁定用于 tx！");
+        if (tf->tx.soft_lock) {
+            TF_REPORT(tf, TF_ERR_TX_BUSY, 0, 0, "TF 已锁定用于 tx！");
             return false;
         }
 
-        tf->soft_lock = true;
+        tf->tx.soft_lock = true;
         return true;
     }
 
     /** 释放** TX 接口，在组合和发送帧之后 */
     static void TF_ReleaseTx(TinyFrame *tf)
     {
-        tf->soft_lock = false;
+        tf->tx.soft_lock = false;
     }
 #endif
 
@@ -208,13 +232,95 @@
 //endregion
 
 
+//region 接收缓冲池
+
+#if TF_USE_RX_POOL
+    // 所有实例共享的接收缓冲区（slab）。只有在头部验证通过后才租用一个，
+    // 帧分发完成后归还，因此内存占用取决于同时在接收的帧数，而不是实例数。
+    // 占用位图使用原子 CAS 更新，可以从多个线程的解析器同时调用。
+
+    #define TF_RX_POOL_WORDS ((TF_RX_POOL_SLABS + 31) / 32)
+
+    static uint8_t rx_pool_slabs[TF_RX_POOL_SLABS][TF_MAX_PAYLOAD_RX];
+    static uint32_t rx_pool_used[TF_RX_POOL_WORDS]; //!< 每个 slab 一位，1 = 已租出
+
+    /** 空帧不租用缓冲区，但 ID 监听器将 data == NULL 视为超时清理，因此指向这里 */
+    static const uint8_t rx_pool_empty[1] = {0};
+
+    /** 租用一个空闲 slab，池耗尽时返回 NULL */
+    static uint8_t * _TF_FN rx_pool_lease(void)
+    {
+        uint32_t w, word, bit, idx;
+        for (w = 0; w < TF_RX_POOL_WORDS; w++) {
+            word = __atomic_load_n(&rx_pool_used[w], __ATOMIC_RELAXED);
+            while (word != 0xFFFFFFFF) {
+                bit = (uint32_t) __builtin_ctz(~word);
+                idx = w * 32 + bit;
+                if (idx >= TF_RX_POOL_SLABS) break; // 最后一个字中不存在的位
+
+                // 失败时 word 被更新为当前值，重新查找
+                if (__atomic_compare_exchange_n(&rx_pool_used[w], &word, word | (1u << bit),
+                                                false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                    return rx_pool_slabs[idx];
+                }
+            }
+        }
+        return NULL;
+    }
+
+    /** 将 slab 归还到池中 */
+    static void _TF_FN rx_pool_return(const uint8_t *buf)
+    {
+        uint32_t idx = (uint32_t) ((buf - &rx_pool_slabs[0][0]) / TF_MAX_PAYLOAD_RX);
+        __atomic_fetch_and(&rx_pool_used[idx / 32], ~(1u << (idx % 32)), __ATOMIC_RELEASE);
+    }
+#endif
+
+//endregion 接收缓冲池
+
+
+//region 共享发送缓冲区
+
+#if TF_USE_SHARED_SENDBUF
+    // 一个线程同一时间只组合一帧，因此发送缓冲区按线程（或事件循环）共享，
+    // 而不是内嵌在每个实例中。帧开始时借用，帧结束时归还。
+
+    static TF_THREAD_LOCAL uint8_t shared_sendbuf[TF_SENDBUF_LEN];
+    static TF_THREAD_LOCAL TinyFrame *shared_sendbuf_owner; //!< 当前借用缓冲区的实例
+
+    /** 借用本线程的发送缓冲区。如果另一个实例的帧尚未结束，则失败。 */
+    static bool _TF_FN sendbuf_acquire(TinyFrame *tf)
+    {
+        if (shared_sendbuf_owner != NULL && shared_sendbuf_owner != tf) {
+            TF_REPORT(tf, TF_ERR_SENDBUF_BUSY, 0, 0, "共享发送缓冲区正被另一个实例使用");
+            return false;
+        }
+        shared_sendbuf_owner = tf;
+        tf->tx.sendbuf = shared_sendbuf;
+        return true;
+    }
+
+    /** 归还本线程的发送缓冲区 */
+    static void _TF_FN sendbuf_release(TinyFrame *tf)
+    {
+        tf->tx.sendbuf = NULL;
+        shared_sendbuf_owner = NULL;
+    }
+#else
+    #define sendbuf_acquire(tf) true
+    #define sendbuf_release(tf) do { (void)(tf); } while (0)
+#endif
+
+//endregion 共享发送缓冲区
+
+
 //region 初始化
 
 /** 使用用户分配的缓冲区初始化 */
 bool _TF_FN TF_InitStatic(TinyFrame *tf, TF_Peer peer_bit)
 {
     if (tf == NULL) {
-        TF_Error("TF_InitStatic() 失败，tf 为空。");
+        TF_REPORT(NULL, TF_ERR_NULL_ARG, 0, 0, "TF_InitStatic() 失败，tf 为空。");
         return false;
     }
 
@@ -236,7 +342,7 @@ TinyFrame * _TF_FN TF_Init(TF_Peer peer_bit)
 {
     TinyFrame *tf = malloc(sizeof(TinyFrame));
     if (!tf) {
-        TF_Error("TF_Init() 失败，内存不足。");
+        TF_REPORT(NULL, TF_ERR_NO_MEMORY, sizeof(TinyFrame), 0, "TF_Init() 失败，内存不足。");
         return NULL;
     }
 
@@ -248,67 +354,673 @@ TinyFrame * _TF_FN TF_Init(TF_Peer peer_bit)
 void TF_DeInit(TinyFrame *tf)
 {
     if (tf == NULL) return;
+#if TF_USE_RX_POOL
+    TF_ResetParser(tf); // 归还租用的缓冲区
+#endif
+#if TF_USE_RX_QUEUE
+    // 归还尚未分发的帧的缓冲区
+    {
+        uint32_t lane;
+        struct TF_RxQueue_ *q;
+        for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+            q = &tf->rx.rxq[lane];
+            while (q->tail != q->head) {
+                if (q->slots[q->tail % TF_RX_QUEUE_LEN].data != NULL) {
+                    rx_pool_return(q->slots[q->tail % TF_RX_QUEUE_LEN].data);
+                }
+                q->tail++;
+            }
+        }
+    }
+#endif
     free(tf);
 }
 
 //endregion 初始化
 
 
+//region 错误报告
+
+#if TF_USE_ERROR_CALLBACK
+
+static TF_ErrorCallback tf_error_cb;
+
+/** 注册错误回调 */
+void _TF_FN TF_SetErrorCallback(TF_ErrorCallback cb)
+{
+    __atomic_store_n(&tf_error_cb, cb, __ATOMIC_RELEASE);
+}
+
+/** 错误码的名称 */
+const char * _TF_FN TF_ErrorName(TF_ErrorCode code)
+{
+    static const char *const names[TF_ERR__COUNT] = {
+        [TF_ERR_TX_BUSY] = "TX_BUSY",
+        [TF_ERR_SENDBUF_BUSY] = "SENDBUF_BUSY",
+        [TF_ERR_NULL_ARG] = "NULL_ARG",
+        [TF_ERR_NO_MEMORY] = "NO_MEMORY",
+        [TF_ERR_TEMPLATE] = "TEMPLATE",
+        [TF_ERR_ID_LISTENER_FULL] = "ID_LISTENER_FULL",
+        [TF_ERR_TYPE_LISTENER_FULL] = "TYPE_LISTENER_FULL",
+        [TF_ERR_GENERIC_LISTENER_FULL] = "GENERIC_LISTENER_FULL",
+        [TF_ERR_LISTENER_NOT_FOUND] = "LISTENER_NOT_FOUND",
+        [TF_ERR_UNHANDLED] = "UNHANDLED",
+        [TF_ERR_NO_PAYLOAD] = "NO_PAYLOAD",
+        [TF_ERR_RX_QUEUE_FULL] = "RX_QUEUE_FULL",
+        [TF_ERR_OVERSIZE] = "OVERSIZE",
+        [TF_ERR_RX_POOL_EMPTY] = "RX_POOL_EMPTY",
+        [TF_ERR_PARSER_TIMEOUT] = "PARSER_TIMEOUT",
+        [TF_ERR_HEAD_CKSUM] = "HEAD_CKSUM",
+        [TF_ERR_BODY_CKSUM] = "BODY_CKSUM",
+        [TF_ERR_RX_BUSY] = "RX_BUSY",
+        [TF_ERR_ID_LISTENER_EXPIRED] = "ID_LISTENER_EXPIRED",
+    };
+
+    if ((unsigned) code >= TF_ERR__COUNT || names[code] == NULL) return "?";
+    return names[code];
+}
+
+/**
+ * 报告错误，按实例和错误码限流
+ *
+ * 被限流的错误只递增一个计数器，因此线路噪声产生的大量错误不会拖慢解析器。
+ * 同一错误码可能在多个线程中报告，计数是近似的（宽松的原子读写，不加锁）。
+ */
+static void _TF_FN tf_report_error(TinyFrame *tf, TF_ErrorCode code, uint32_t arg1, uint32_t arg2)
+{
+    TF_ErrorCallback cb = __atomic_load_n(&tf_error_cb, __ATOMIC_ACQUIRE);
+    struct TF_ErrorLimit_ *lim;
+    uint32_t window;
+    uint32_t suppressed = 0;
+
+    if (cb == NULL) return;
+
+    if (tf != NULL) {
+        lim = &tf->err.limits[code];
+        window = TF_LOAD_RELAXED(tf->err.window);
+
+        if (TF_LOAD_RELAXED(lim->window) != window) {
+            // 新的时间窗口
+            TF_STORE_RELAXED(lim->window, window);
+            TF_STORE_RELAXED(lim->count, 0);
+        }
+
+        if (TF_LOAD_RELAXED(lim->count) >= TF_ERROR_BURST) {
+            TF_STORE_RELAXED(lim->suppressed, TF_LOAD_RELAXED(lim->suppressed) + 1);
+            return;
+        }
+
+        TF_STORE_RELAXED(lim->count, TF_LOAD_RELAXED(lim->count) + 1);
+        suppressed = TF_LOAD_RELAXED(lim->suppressed);
+        TF_STORE_RELAXED(lim->suppressed, 0);
+    }
+
+    cb(tf, code, arg1, arg2, suppressed);
+}
+
+#endif
+
+//endregion 错误报告
+
+
+//region 抓包
+
+#if TF_USE_CAPTURE
+
+/** 初始化抓包环 */
+void _TF_FN TF_CaptureInit(TF_CaptureRing *ring)
+{
+    uint32_t i;
+
+    memset(ring, 0, sizeof(TF_CaptureRing));
+    for (i = 0; i < TF_CAPTURE_SLOTS; i++) {
+        ring->slots[i].seq = i; // 空闲，等待位置 i 的生产者
+    }
+}
+
+/** 开始或停止抓包 */
+void _TF_FN TF_SetCapture(TinyFrame *tf, TF_CaptureRing *ring)
+{
+    __atomic_store_n(&tf->capture, ring, __ATOMIC_RELEASE);
+}
+
+/**
+ * 占用一个槽。
+ *
+ * 槽的序号等于位置时空闲；生产者用 CAS 推进 head 来占用它，填写后将序号设为位置 + 1 以提交。
+ * 消费者读取后将序号设为位置 + 环长度，槽在下一圈中再次空闲。
+ *
+ * @return 槽，环已满时返回 NULL
+ */
+static struct TF_CaptureSlot_ * _TF_FN capture_claim(TF_CaptureRing *ring, uint32_t *pos_out)
+{
+    uint32_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    struct TF_CaptureSlot_ *slot;
+    int32_t diff;
+
+    for (;;) {
+        slot = &ring->slots[pos & (TF_CAPTURE_SLOTS - 1)];
+        diff = (int32_t) (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            // 空闲；失败时 pos 被更新为当前的 head
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return slot;
+            }
+        }
+        else if (diff < 0) {
+            // 消费者还没有读取上一圈的记录
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        else {
+            // 另一个生产者已占用此位置
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/** 提交填写好的槽 */
+static inline void _TF_FN capture_publish(struct TF_CaptureSlot_ *slot, uint32_t pos)
+{
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+/** 占用槽并填写帧头，返回 NULL 表示不抓包 */
+static struct TF_CaptureSlot_ * _TF_FN capture_begin(TinyFrame *tf, TF_CaptureDir dir, TF_ID id, TF_TYPE type, TF_LEN len, uint32_t *pos_out)
+{
+    TF_CaptureRing *ring = __atomic_load_n(&tf->capture, __ATOMIC_ACQUIRE);
+    struct TF_CaptureSlot_ *slot;
+
+    if (ring == NULL) return NULL;
+
+    slot = capture_claim(ring, pos_out);
+    if (slot == NULL) return NULL;
+
+    slot->rec.timestamp = TF_Timestamp();
+    slot->rec.usertag = tf->usertag;
+    slot->rec.dir = (uint8_t) dir;
+    slot->rec.id = id;
+    slot->rec.type = type;
+    slot->rec.len = len;
+    slot->rec.caplen = 0;
+    return slot;
+}
+
+/** 将负载的一部分复制到槽中（超过 TF_CAPTURE_SNAPLEN 的部分被截断） */
+static inline void _TF_FN capture_payload(struct TF_CaptureSlot_ *slot, const uint8_t *data, uint32_t len)
+{
+    uint32_t n = TF_MIN(len, (uint32_t) (TF_CAPTURE_SNAPLEN - slot->rec.caplen));
+
+    if (n > 0) {
+        memcpy(slot->rec.data + slot->rec.caplen, data, n);
+        slot->rec.caplen = (TF_LEN) (slot->rec.caplen + n);
+    }
+}
+
+/** 抓取接收到的帧 */
+static void _TF_FN capture_rx(TinyFrame *tf)
+{
+    uint32_t pos;
+    struct TF_CaptureSlot_ *slot = capture_begin(tf, TF_CAPTURE_RX, tf->rx.id, tf->rx.type, tf->rx.len, &pos);
+
+    if (slot == NULL) return;
+    if (tf->rx.len > 0) capture_payload(slot, tf->rx.data, tf->rx.len);
+    capture_publish(slot, pos);
+}
+
+/** 发送的帧开始：占用槽，负载在发送时复制 */
+static void _TF_FN capture_tx_begin(TinyFrame *tf, const TF_Msg *msg)
+{
+    tf->tx.cap_slot = capture_begin(tf, TF_CAPTURE_TX, msg->frame_id, msg->type, msg->len, &tf->tx.cap_pos);
+}
+
+static inline void _TF_FN capture_tx_chunk(TinyFrame *tf, const uint8_t *buff, uint32_t length)
+{
+    if (tf->tx.cap_slot != NULL) capture_payload(tf->tx.cap_slot, buff, length);
+}
+
+static inline void _TF_FN capture_tx_end(TinyFrame *tf)
+{
+    if (tf->tx.cap_slot != NULL) {
+        capture_publish(tf->tx.cap_slot, tf->tx.cap_pos);
+        tf->tx.cap_slot = NULL;
+    }
+}
+
+/** 读取下一条记录 */
+bool _TF_FN TF_CaptureRead(TF_CaptureRing *ring, TF_CaptureRecord *out)
+{
+    uint32_t pos = ring->tail;
+    struct TF_CaptureSlot_ *slot = &ring->slots[pos & (TF_CAPTURE_SLOTS - 1)];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) {
+        return false; // 空，或者下一条记录还没有提交
+    }
+
+    // 只复制头部和保存的负载
+    memcpy(out, &slot->rec, offsetof(TF_CaptureRecord, data) + slot->rec.caplen);
+
+    __atomic_store_n(&slot->seq, pos + TF_CAPTURE_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail, pos + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/** 丢弃的记录数量 */
+uint32_t _TF_FN TF_CaptureDropped(TF_CaptureRing *ring)
+{
+    return __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+}
+
+#else
+    #define capture_rx(tf) do { (void)(tf); } while (0)
+    #define capture_tx_begin(tf, msg) do { (void)(tf); } while (0)
+    #define capture_tx_chunk(tf, buff, length) do { (void)(tf); } while (0)
+    #define capture_tx_end(tf) do { (void)(tf); } while (0)
+#endif
+
+//endregion 抓包
+
+
+/** 调用一个监听器（跟踪点 dispatch_begin/dispatch_end 之间） */
+static inline TF_Result _TF_FN call_listener(TinyFrame *tf, TF_Listener fn, TF_Msg *msg, TF_TraceListenerKind kind)
+{
+    TF_Result res;
+    (void) kind;
+
+    TF_TRACE(dispatch_begin, tf, kind, msg->type);
+    res = fn(tf, msg);
+    TF_TRACE(dispatch_end, tf, kind, res);
+    return res;
+}
+
+
+//region 监听器模板
+
+#if TF_USE_LISTENER_TEMPLATE
+
+/** 初始化静态分配的模板 */
+bool _TF_FN TF_TemplateInitStatic(TF_ListenerTemplate *tpl)
+{
+    if (tpl == NULL) {
+        TF_REPORT(NULL, TF_ERR_NULL_ARG, 0, 0, "TF_TemplateInitStatic() 失败，tpl 为空。");
+        return false;
+    }
+
+    memset(tpl, 0, sizeof(struct TF_ListenerTemplate_));
+    return true;
+}
+
+/** 使用 malloc 创建模板 */
+TF_ListenerTemplate * _TF_FN TF_TemplateInit(void)
+{
+    TF_ListenerTemplate *tpl = malloc(sizeof(TF_ListenerTemplate));
+    if (!tpl) {
+        TF_REPORT(NULL, TF_ERR_NO_MEMORY, sizeof(TF_ListenerTemplate), 0, "TF_TemplateInit() 失败，内存不足。");
+        return NULL;
+    }
+
+    TF_TemplateInitStatic(tpl);
+    return tpl;
+}
+
+/** 释放模板 */
+void _TF_FN TF_TemplateDeInit(TF_ListenerTemplate *tpl)
+{
+    free(tpl);
+}
+
+/** 向模板添加类型监听器 */
+bool _TF_FN TF_TemplateAddTypeListener(TF_ListenerTemplate *tpl, TF_TYPE frame_type, TF_Listener cb)
+{
+    struct TF_TypeListener_ *lst;
+
+    if (tpl->frozen || tpl->count_type_lst >= TF_MAX_TEMPLATE_TYPE_LST) {
+        TF_REPORT(NULL, TF_ERR_TEMPLATE, frame_type, 0, "添加模板类型监听器失败");
+        return false;
+    }
+
+    lst = &tpl->type_listeners[tpl->count_type_lst++];
+    lst->type = frame_type;
+    lst->fn = cb;
+    return true;
+}
+
+/** 向模板添加通用监听器 */
+bool _TF_FN TF_TemplateAddGenericListener(TF_ListenerTemplate *tpl, TF_Listener cb)
+{
+    if (tpl->frozen || tpl->count_generic_lst >= TF_MAX_TEMPLATE_GEN_LST) {
+        TF_REPORT(NULL, TF_ERR_TEMPLATE, 0, 0, "添加模板通用监听器失败");
+        return false;
+    }
+
+    tpl->generic_listeners[tpl->count_generic_lst++].fn = cb;
+    return true;
+}
+
+/** 冻结模板 */
+void _TF_FN TF_TemplateFreeze(TF_ListenerTemplate *tpl)
+{
+    uint32_t i, j;
+    struct TF_TypeListener_ tmp;
+
+    if (tpl->frozen) return;
+
+    // 插入排序 - 稳定，同一类型的监听器保持添加顺序。只在启动时运行一次。
+    for (i = 1; i < tpl->count_type_lst; i++) {
+        tmp = tpl->type_listeners[i];
+        for (j = i; j > 0 && tpl->type_listeners[j - 1].type > tmp.type; j--) {
+            tpl->type_listeners[j] = tpl->type_listeners[j - 1];
+        }
+        tpl->type_listeners[j] = tmp;
+    }
+
+    tpl->frozen = true;
+}
+
+/** 初始化实例并附加模板 */
+bool _TF_FN TF_InitStaticFromTemplate(TinyFrame *tf, TF_Peer peer_bit, const TF_ListenerTemplate *tpl)
+{
+    if (tpl != NULL && !tpl->frozen) {
+        TF_REPORT(tf, TF_ERR_TEMPLATE, 0, 0, "TF_InitStaticFromTemplate() 失败，模板未冻结。");
+        return false;
+    }
+
+    TF_TRY(TF_InitStatic(tf, peer_bit));
+    tf->reg.tpl = tpl;
+    return true;
+}
+
+/** 使用 malloc 初始化实例并附加模板 */
+TinyFrame * _TF_FN TF_InitFromTemplate(TF_Peer peer_bit, const TF_ListenerTemplate *tpl)
+{
+    TinyFrame *tf = TF_Init(peer_bit);
+    if (!tf) return NULL;
+
+    if (!TF_InitStaticFromTemplate(tf, peer_bit, tpl)) {
+        free(tf);
+        return NULL;
+    }
+    return tf;
+}
+
+/**
+ * 运行模板中匹配的类型监听器（模板不可变，不需要锁）
+ *
+ * @return 消息是否被处理（监听器返回了 TF_NEXT 以外的结果）
+ */
+static bool _TF_FN tpl_dispatch_type(TinyFrame *tf, const TF_ListenerTemplate *tpl, TF_TYPE type, TF_Msg *msg)
+{
+    uint32_t lo = 0, hi = tpl->count_type_lst, mid;
+
+    // 二分查找该类型的第一个监听器
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (tpl->type_listeners[mid].type < type) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < tpl->count_type_lst && tpl->type_listeners[lo].type == type; lo++) {
+        // TF_CLOSE 和 TF_RENEW 在这里等同于 TF_STAY
+        if (call_listener(tf, tpl->type_listeners[lo].fn, msg, TF_TRACE_TEMPLATE_TYPE_LISTENER) != TF_NEXT) return true;
+    }
+    return false;
+}
+
+/**
+ * 运行模板中的通用监听器
+ *
+ * @return 消息是否被处理
+ */
+static bool _TF_FN tpl_dispatch_generic(TinyFrame *tf, const TF_ListenerTemplate *tpl, TF_Msg *msg)
+{
+    uint32_t i;
+
+    for (i = 0; i < tpl->count_generic_lst; i++) {
+        if (call_listener(tf, tpl->generic_listeners[i].fn, msg, TF_TRACE_TEMPLATE_GENERIC_LISTENER) != TF_NEXT) return true;
+    }
+    return false;
+}
+
+#endif
+
+//endregion 监听器模板
+
+
 //region 监听器
 
+#if TF_USE_REGISTRY_LOCK
+    // 监听器表由注册表锁保护。持有锁时从不调用用户回调，
+    // 因此回调中可以注册/移除监听器或发送帧（TF_Query 会添加 ID 监听器）。
+    #define REGISTRY_LOCK(tf)   TF_ClaimRegistry(tf)
+    #define REGISTRY_UNLOCK(tf) TF_ReleaseRegistry(tf)
+#else
+    #define REGISTRY_LOCK(tf)   do { (void)(tf); } while (0)
+    #define REGISTRY_UNLOCK(tf) do { (void)(tf); } while (0)
+#endif
+
+#if TF_USE_RCU_LISTENERS
+
+/**
+ * 进入读侧临界区，返回当前发布的类型/通用监听器表。
+ * 读者只在查找期间停留在临界区内，回调在临界区之外运行。
+ */
+static const struct TF_ListenerTable_ * _TF_FN lst_read_begin(TinyFrame *tf, uint32_t *ticket)
+{
+    uint32_t e;
+
+    for (;;) {
+        e = __atomic_load_n(&tf->reg.epoch, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&tf->reg.readers[e & 1], 1, __ATOMIC_SEQ_CST);
+        // 如果在此期间发布了新版本，写者可能在我们计数之前已经开始改写这个表，重试
+        if (__atomic_load_n(&tf->reg.epoch, __ATOMIC_SEQ_CST) == e) break;
+        __atomic_sub_fetch(&tf->reg.readers[e & 1], 1, __ATOMIC_RELEASE);
+    }
+
+    *ticket = e & 1;
+    return &tf->reg.tables[e & 1];
+}
+
+/** 离开读侧临界区 */
+static inline void _TF_FN lst_read_end(TinyFrame *tf, uint32_t ticket)
+{
+    __atomic_sub_fetch(&tf->reg.readers[ticket], 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 开始修改监听器表（调用者持有注册表锁）。
+ * 等待上一个版本的读者离开（宽限期），然后将当前版本复制到上一个版本的位置并返回它。
+ * 修改在 lst_write_commit() 之前对读者不可见。
+ */
+static struct TF_ListenerTable_ * _TF_FN lst_write_begin(TinyFrame *tf)
+{
+    uint32_t next = (__atomic_load_n(&tf->reg.epoch, __ATOMIC_RELAXED) + 1) & 1;
+
+    while (__atomic_load_n(&tf->reg.readers[next], __ATOMIC_SEQ_CST) != 0) {
+        TF_RCU_RELAX();
+    }
+
+    tf->reg.tables[next] = tf->reg.tables[next ^ 1];
+    return &tf->reg.tables[next];
+}
+
+/** 发布修改后的表，之后的读者将看到它 */
+static inline void _TF_FN lst_write_commit(TinyFrame *tf)
+{
+    __atomic_add_fetch(&tf->reg.epoch, 1, __ATOMIC_SEQ_CST);
+}
+
+#else
+
+// 只有一个版本，读者和写者都由注册表锁保护
+
+static inline const struct TF_ListenerTable_ * _TF_FN lst_read_begin(TinyFrame *tf, uint32_t *ticket)
+{
+    (void) ticket;
+    REGISTRY_LOCK(tf);
+    return &tf->reg.tables[0];
+}
+
+static inline void _TF_FN lst_read_end(TinyFrame *tf, uint32_t ticket)
+{
+    (void) ticket;
+    REGISTRY_UNLOCK(tf);
+}
+
+static inline struct TF_ListenerTable_ * _TF_FN lst_write_begin(TinyFrame *tf)
+{
+    return &tf->reg.tables[0];
+}
+
+static inline void _TF_FN lst_write_commit(TinyFrame *tf)
+{
+    (void) tf;
+}
+
+#endif
+
 /** 将 ID 监听器的超时重置为原始值 */
 static inline void _TF_FN renew_id_listener(struct TF_IdListener_ *lst)
 {
     lst->timeout = lst->timeout_max;
 }
 
-/** 通知回调 ID 监听器已被终止，并让其释放 userdata 中的任何资源 */
-static void _TF_FN cleanup_id_listener(TinyFrame *tf, TF_COUNT i, struct TF_IdListener_ *lst)
+/** 释放 ID 监听器的槽（调用者持有注册表锁） */
+static void _TF_FN release_id_listener(TinyFrame *tf, TF_COUNT i, struct TF_IdListener_ *lst)
+{
+    lst->fn = NULL; // 丢弃监听器
+    lst->fn_timeout = NULL;
+    TF_STAT_ADD(tf->reg.stats.id_listeners_inflight, -1);
+
+    if (i == tf->reg.count_id_lst - 1) {
+        tf->reg.count_id_lst--;
+    }
+}
+
+#if TF_USE_LATENCY
+
+/** 延迟值所在的直方图桶 */
+static uint32_t _TF_FN latency_bucket(uint64_t v)
+{
+    uint32_t e;
+
+    if (v < ((uint64_t) 1 << TF_LATENCY_SUB_BITS)) return (uint32_t) v;
+    if (v >> TF_LATENCY_MAX_BITS) return TF_LATENCY_BUCKETS - 1;
+
+    // e 是最高位的位置，其下的 TF_LATENCY_SUB_BITS 位选择区间内的桶
+    e = 63 - (uint32_t) __builtin_clzll(v);
+    return ((e - TF_LATENCY_SUB_BITS + 1) << TF_LATENCY_SUB_BITS)
+           + (uint32_t) (v >> (e - TF_LATENCY_SUB_BITS)) - (1u << TF_LATENCY_SUB_BITS);
+}
+
+/** 查询类型的直方图，必要时分配一个（调用者持有注册表锁） */
+static struct TF_LatencyHist_ * _TF_FN latency_hist(TinyFrame *tf, TF_TYPE type, bool create)
+{
+    struct TF_LatencyTable_ *lt = &tf->reg.latency;
+    uint32_t i;
+
+    for (i = 0; i < lt->count; i++) {
+        if (lt->types[i] == type) return &lt->hist[i];
+    }
+    if (!create || lt->count == TF_LATENCY_TYPES) return NULL;
+
+    lt->types[lt->count] = type;
+    return &lt->hist[lt->count++];
+}
+
+/**
+ * 记录一次查询的延迟（调用者持有注册表锁）
+ *
+ * @param now - 响应或超时的时间，由调用者在获取锁之前读取（持有锁时不调用 TF_Timestamp()）
+ */
+static void _TF_FN latency_record(TinyFrame *tf, struct TF_IdListener_ *lst, uint64_t now, bool timeout)
+{
+    struct TF_LatencyHist_ *h;
+    uint64_t v;
+
+    lst->timed = false;
+    h = latency_hist(tf, lst->type, true);
+    if (h == NULL) {
+        tf->reg.latency.untracked++;
+        return;
+    }
+
+    v = now - lst->sent_at;
+    h->buckets[latency_bucket(v)]++;
+    if (h->count == 0 || v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+    h->sum += v;
+    h->count++;
+    if (timeout) h->timeouts++;
+}
+
+    // 查询收到第一个响应，或者在没有响应的情况下超时
+    #define latency_response(tf, lst, now) do { if ((lst)->timed) latency_record((tf), (lst), (now), false); } while (0)
+    #define latency_timeout(tf, lst, now) do { if ((lst)->timed) latency_record((tf), (lst), (now), true); } while (0)
+    #define latency_now() TF_Timestamp()
+#else
+    #define latency_response(tf, lst, now) do { (void)(tf); (void)(now); } while (0)
+    #define latency_timeout(tf, lst, now) do { (void)(tf); (void)(now); } while (0)
+    #define latency_now() 0
+#endif
+
+/**
+ * 通知回调 ID 监听器已被终止，并让其释放 userdata 中的任何资源。
+ * 在释放槽之后、不持有注册表锁时，使用监听器的副本调用。
+ */
+static void _TF_FN notify_id_listener_cleanup(TinyFrame *tf, const struct TF_IdListener_ *lst)
 {
     TF_Msg msg;
     if (lst->fn == NULL) return;
 
     // 让用户清理他们的数据 - 仅当不为 NULL 时
     if (lst->userdata != NULL || lst->userdata2 != NULL) {
+        TF_ClearMsg(&msg);
+        msg.frame_id = lst->id;
         msg.userdata = lst->userdata;
         msg.userdata2 = lst->userdata2;
         msg.data = NULL; // 这是一个信号，表示监听器应该清理
         lst->fn(tf, &msg); // 此处忽略返回值 - 使用 TF_STAY 或 TF_CLOSE
     }
-
-    lst->fn = NULL; // 丢弃监听器
-    lst->fn_timeout = NULL;
-
-    if (i == tf->count_id_lst - 1) {
-        tf->count_id_lst--;
-    }
 }
 
 /** 清理类型监听器 */
-static inline void _TF_FN cleanup_type_listener(TinyFrame *tf, TF_COUNT i, struct TF_TypeListener_ *lst)
+static inline void _TF_FN cleanup_type_listener(struct TF_ListenerTable_ *tbl, TF_COUNT i, struct TF_TypeListener_ *lst)
 {
     lst->fn = NULL; // 丢弃监听器
-    if (i == tf->count_type_lst - 1) {
-        tf->count_type_lst--;
+    if (i == tbl->count_type_lst - 1) {
+        tbl->count_type_lst--;
     }
 }
 
 /** 清理通用监听器 */
-static inline void _TF_FN cleanup_generic_listener(TinyFrame *tf, TF_COUNT i, struct TF_GenericListener_ *lst)
+static inline void _TF_FN cleanup_generic_listener(struct TF_ListenerTable_ *tbl, TF_COUNT i, struct TF_GenericListener_ *lst)
 {
     lst->fn = NULL; // 丢弃监听器
-    if (i == tf->count_generic_lst - 1) {
-        tf->count_generic_lst--;
+    if (i == tbl->count_generic_lst - 1) {
+        tbl->count_generic_lst--;
     }
 }
 
-/** 添加一个新的 ID 监听器。成功时返回 1。 */
-bool _TF_FN TF_AddIdListener(TinyFrame *tf, TF_Msg *msg, TF_Listener cb, TF_Listener_Timeout ftimeout, TF_TICKS timeout)
+/**
+ * 添加 ID 监听器
+ *
+ * @param sent_at - 查询开始发送的时间，用于记录延迟
+ * @param timed - 这是 TF_Query() 等函数的监听器，记录延迟
+ */
+static bool _TF_FN add_id_listener(TinyFrame *tf, TF_Msg *msg, TF_Listener cb, TF_Listener_Timeout ftimeout, TF_TICKS timeout,
+                                   uint64_t sent_at, bool timed)
 {
     TF_COUNT i;
     struct TF_IdListener_ *lst;
+
+    REGISTRY_LOCK(tf);
     for (i = 0; i < TF_MAX_ID_LST; i++) {
-        lst = &tf->id_listeners[i];
+        lst = &tf->reg.id_listeners[i];
         // 测试空槽
         if (lst->fn == NULL) {
             lst->fn = cb;
@@ -317,36 +1029,65 @@ bool _TF_FN TF_AddIdListener(TinyFrame *tf, TF_Msg *msg, TF_Listener cb, TF_List
             lst->userdata = msg->userdata;
             lst->userdata2 = msg->userdata2;
             lst->timeout_max = lst->timeout = timeout;
-            if (i >= tf->count_id_lst) {
-                tf->count_id_lst = (TF_COUNT) (i + 1);
+#if TF_USE_LATENCY
+            lst->sent_at = sent_at;
+            lst->type = msg->type;
+            lst->timed = timed;
+#else
+            (void) sent_at;
+            (void) timed;
+#endif
+            if (i >= tf->reg.count_id_lst) {
+                tf->reg.count_id_lst = (TF_COUNT) (i + 1);
             }
+#if TF_USE_STATS
+            TF_STAT_INC(tf->reg.stats.id_listeners_inflight);
+            if (tf->reg.stats.id_listeners_inflight > tf->reg.stats.id_listeners_peak) {
+                TF_STORE_RELAXED(tf->reg.stats.id_listeners_peak, tf->reg.stats.id_listeners_inflight);
+            }
+#endif
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("添加 ID 监听器失败");
+    TF_REPORT(tf, TF_ERR_ID_LISTENER_FULL, msg->frame_id, 0, "添加 ID 监听器失败");
     return false;
 }
 
+/** 添加一个新的 ID 监听器。成功时返回 1。 */
+bool _TF_FN TF_AddIdListener(TinyFrame *tf, TF_Msg *msg, TF_Listener cb, TF_Listener_Timeout ftimeout, TF_TICKS timeout)
+{
+    return add_id_listener(tf, msg, cb, ftimeout, timeout, 0, false);
+}
+
 /** 添加一个新的类型监听器。成功时返回 1。 */
 bool _TF_FN TF_AddTypeListener(TinyFrame *tf, TF_TYPE frame_type, TF_Listener cb)
 {
     TF_COUNT i;
     struct TF_TypeListener_ *lst;
+    struct TF_ListenerTable_ *tbl;
+
+    REGISTRY_LOCK(tf);
+    tbl = lst_write_begin(tf);
     for (i = 0; i < TF_MAX_TYPE_LST; i++) {
-        lst = &tf->type_listeners[i];
+        lst = &tbl->type_listeners[i];
         // 测试空槽
         if (lst->fn == NULL) {
             lst->fn = cb;
             lst->type = frame_type;
-            if (i >= tf->count_type_lst) {
-                tf->count_type_lst = (TF_COUNT) (i + 1);
+            if (i >= tbl->count_type_lst) {
+                tbl->count_type_lst = (TF_COUNT) (i + 1);
             }
+            lst_write_commit(tf);
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("添加类型监听器失败");
+    TF_REPORT(tf, TF_ERR_TYPE_LISTENER_FULL, frame_type, 0, "添加类型监听器失败");
     return false;
 }
 
@@ -355,19 +1096,26 @@ bool _TF_FN TF_AddGenericListener(TinyFrame *tf, TF_Listener cb)
 {
     TF_COUNT i;
     struct TF_GenericListener_ *lst;
+    struct TF_ListenerTable_ *tbl;
+
+    REGISTRY_LOCK(tf);
+    tbl = lst_write_begin(tf);
     for (i = 0; i < TF_MAX_GEN_LST; i++) {
-        lst = &tf->generic_listeners[i];
+        lst = &tbl->generic_listeners[i];
         // 测试空槽
         if (lst->fn == NULL) {
             lst->fn = cb;
-            if (i >= tf->count_generic_lst) {
-                tf->count_generic_lst = (TF_COUNT) (i + 1);
+            if (i >= tbl->count_generic_lst) {
+                tbl->count_generic_lst = (TF_COUNT) (i + 1);
             }
+            lst_write_commit(tf);
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("添加通用监听器失败");
+    TF_REPORT(tf, TF_ERR_GENERIC_LISTENER_FULL, 0, 0, "添加通用监听器失败");
     return false;
 }
 
@@ -376,16 +1124,24 @@ bool _TF_FN TF_RemoveIdListener(TinyFrame *tf, TF_ID frame_id)
 {
     TF_COUNT i;
     struct TF_IdListener_ *lst;
-    for (i = 0; i < tf->count_id_lst; i++) {
-        lst = &tf->id_listeners[i];
+    struct TF_IdListener_ removed;
+
+    REGISTRY_LOCK(tf);
+    for (i = 0; i < tf->reg.count_id_lst; i++) {
+        lst = &tf->reg.id_listeners[i];
         // 测试是否存活且匹配
         if (lst->fn != NULL && lst->id == frame_id) {
-            cleanup_id_listener(tf, i, lst);
+            removed = *lst;
+            release_id_listener(tf, i, lst);
+            REGISTRY_UNLOCK(tf);
+
+            notify_id_listener_cleanup(tf, &removed);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("要移除的 ID 监听器 %d 未找到", (int)frame_id);
+    TF_REPORT(tf, TF_ERR_LISTENER_NOT_FOUND, frame_id, 0, "要移除的 ID 监听器 %d 未找到", (int)frame_id);
     return false;
 }
 
@@ -394,16 +1150,23 @@ bool _TF_FN TF_RemoveTypeListener(TinyFrame *tf, TF_TYPE type)
 {
     TF_COUNT i;
     struct TF_TypeListener_ *lst;
-    for (i = 0; i < tf->count_type_lst; i++) {
-        lst = &tf->type_listeners[i];
+    struct TF_ListenerTable_ *tbl;
+
+    REGISTRY_LOCK(tf);
+    tbl = lst_write_begin(tf);
+    for (i = 0; i < tbl->count_type_lst; i++) {
+        lst = &tbl->type_listeners[i];
         // 测试是否存活且匹配
         if (lst->fn != NULL    && lst->type == type) {
-            cleanup_type_listener(tf, i, lst);
+            cleanup_type_listener(tbl, i, lst);
+            lst_write_commit(tf);
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("要移除的类型监听器 %d 未找到", (int)type);
+    TF_REPORT(tf, TF_ERR_LISTENER_NOT_FOUND, type, 0, "要移除的类型监听器 %d 未找到", (int)type);
     return false;
 }
 
@@ -412,50 +1175,85 @@ bool _TF_FN TF_RemoveGenericListener(TinyFrame *tf, TF_Listener cb)
 {
     TF_COUNT i;
     struct TF_GenericListener_ *lst;
-    for (i = 0; i < tf->count_generic_lst; i++) {
-        lst = &tf->generic_listeners[i];
+    struct TF_ListenerTable_ *tbl;
+
+    REGISTRY_LOCK(tf);
+    tbl = lst_write_begin(tf);
+    for (i = 0; i < tbl->count_generic_lst; i++) {
+        lst = &tbl->generic_listeners[i];
         // 测试是否存活且匹配
         if (lst->fn == cb) {
-            cleanup_generic_listener(tf, i, lst);
+            cleanup_generic_listener(tbl, i, lst);
+            lst_write_commit(tf);
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("要移除的通用监听器未找到");
+    TF_REPORT(tf, TF_ERR_LISTENER_NOT_FOUND, 0, 0, "要移除的通用监听器未找到");
     return false;
 }
 
-/** 处理由解析器刚刚收集和验证的消息 */
-static void _TF_FN TF_HandleReceivedMessage(TinyFrame *tf)
+/**
+ * 将消息交给监听器
+ *
+ * @param tf - 实例
+ * @param msg_in - 准备好的消息对象（frame_id、type、data、len）
+ * @return 如果有监听器处理了消息（返回 TF_NEXT 以外的结果），则返回 true
+ */
+static bool _TF_FN dispatch_message(TinyFrame *tf, const TF_Msg *msg_in)
 {
     TF_COUNT i;
     struct TF_IdListener_ *ilst;
-    struct TF_TypeListener_ *tlst;
-    struct TF_GenericListener_ *glst;
+    const struct TF_TypeListener_ *tlst;
+    const struct TF_GenericListener_ *glst;
+    const struct TF_ListenerTable_ *tbl;
+    struct TF_ListenerTable_ *wtbl;
+    uint32_t ticket;
+    TF_Listener fn;
     TF_Result res;
 
-    // 准备消息对象
-    TF_Msg msg;
-    TF_ClearMsg(&msg);
-    msg.frame_id = tf->id;
-    msg.is_response = false;
-    msg.type = tf->type;
-    msg.data = tf->data;
-    msg.len = tf->len;
+    // 本地副本，监听器可以修改它（例如用于 TF_Respond）
+    TF_Msg msg = *msg_in;
+
+    // 查询的响应时间，在获取锁之前读取
+    uint64_t now = latency_now();
 
     // 任何监听器都可以消耗消息，或者让其他人处理。
 
     // 循环上限是当前使用的最高槽索引
     // （或者接近它，取决于监听器的移除顺序）。
 
+    // 回调在注册表锁（和读侧临界区）之外运行。之后重新检查槽，
+    // 因为在此期间它可能已被其他线程（或回调本身）移除或重用。
+    // 槽的索引在表的各个版本之间保持不变，因此可以在新版本中从下一个槽继续查找。
+
+    REGISTRY_LOCK(tf);
+
     // 首先是 ID 监听器
-    for (i = 0; i < tf->count_id_lst; i++) {
-        ilst = &tf->id_listeners[i];
+    for (i = 0; i < tf->reg.count_id_lst; i++) {
+        ilst = &tf->reg.id_listeners[i];
 
-        if (ilst->fn && ilst->id == msg.frame_id) {
+        if (ilst->fn && ilst->id == msg_in->frame_id) {
+            fn = ilst->fn;
             msg.userdata = ilst->userdata; // 将 userdata 指针传递给回调
             msg.userdata2 = ilst->userdata2;
-            res = ilst->fn(tf, &msg);
+            latency_response(tf, ilst, now);
+
+            REGISTRY_UNLOCK(tf);
+            res = call_listener(tf, fn, &msg, TF_TRACE_ID_LISTENER);
+            REGISTRY_LOCK(tf);
+
+            if (ilst->fn != fn || ilst->id != msg_in->frame_id) {
+                // 监听器在回调期间被移除
+                if (res != TF_NEXT) {
+                    REGISTRY_UNLOCK(tf);
+                    return true;
+                }
+                continue;
+            }
+
             ilst->userdata = msg.userdata; // 把它放回去（可能已更改指针或设置为 NULL）
             ilst->userdata2 = msg.userdata2; // 把它放回去（可能已更改指针或设置为 NULL）
 
@@ -465,45 +1263,70 @@ static void _TF_FN TF_HandleReceivedMessage(TinyFrame *tf)
                     renew_id_listener(ilst);
                 }
                 else if (res == TF_CLOSE) {
-                    // 将 userdata 设置为 NULL 以避免调用用户进行清理
-                    ilst->userdata = NULL;
-                    ilst->userdata2 = NULL;
-                    cleanup_id_listener(tf, i, ilst);
+                    // 直接释放槽，不调用用户进行清理
+                    release_id_listener(tf, i, ilst);
                 }
-                return;
+                REGISTRY_UNLOCK(tf);
+                return true;
             }
         }
     }
+    REGISTRY_UNLOCK(tf);
+
     // 为不使用 userdata 的后续监听器清理（这避免了从返回 TF_NEXT 的 ID 监听器中的数据
     // 泄漏到类型和通用监听器）
     msg.userdata = NULL;
     msg.userdata2 = NULL;
 
     // 类型监听器
-    for (i = 0; i < tf->count_type_lst; i++) {
-        tlst = &tf->type_listeners[i];
+    tbl = lst_read_begin(tf, &ticket);
+    for (i = 0; i < tbl->count_type_lst; i++) {
+        tlst = &tbl->type_listeners[i];
 
-        if (tlst->fn && tlst->type == msg.type) {
-            res = tlst->fn(tf, &msg);
+        if (tlst->fn && tlst->type == msg_in->type) {
+            fn = tlst->fn;
+
+            lst_read_end(tf, ticket);
+            res = call_listener(tf, fn, &msg, TF_TRACE_TYPE_LISTENER);
 
             if (res != TF_NEXT) {
                 // 类型监听器没有 userdata。
                 // TF_RENEW 在这里没有意义，因为类型监听器不会过期 = 等同于 TF_STAY
 
                 if (res == TF_CLOSE) {
-                    cleanup_type_listener(tf, i, tlst);
+                    REGISTRY_LOCK(tf);
+                    wtbl = lst_write_begin(tf);
+                    if (wtbl->type_listeners[i].fn == fn && wtbl->type_listeners[i].type == msg_in->type) {
+                        cleanup_type_listener(wtbl, i, &wtbl->type_listeners[i]);
+                        lst_write_commit(tf);
+                    }
+                    REGISTRY_UNLOCK(tf);
                 }
-                return;
+                return true;
             }
+
+            tbl = lst_read_begin(tf, &ticket);
         }
     }
 
+#if TF_USE_LISTENER_TEMPLATE
+    // 共享模板的类型监听器，在实例自己的类型监听器之后
+    if (tf->reg.tpl != NULL) {
+        lst_read_end(tf, ticket);
+        if (tpl_dispatch_type(tf, tf->reg.tpl, msg_in->type, &msg)) return true;
+        tbl = lst_read_begin(tf, &ticket);
+    }
+#endif
+
     // 通用监听器
-    for (i = 0; i < tf->count_generic_lst; i++) {
-        glst = &tf->generic_listeners[i];
+    for (i = 0; i < tbl->count_generic_lst; i++) {
+        glst = &tbl->generic_listeners[i];
 
         if (glst->fn) {
-            res = glst->fn(tf, &msg);
+            fn = glst->fn;
+
+            lst_read_end(tf, ticket);
+            res = call_listener(tf, fn, &msg, TF_TRACE_GENERIC_LISTENER);
 
             if (res != TF_NEXT) {
                 // 通用监听器没有 userdata。
@@ -513,14 +1336,45 @@ static void _TF_FN TF_HandleReceivedMessage(TinyFrame *tf)
                 // 或者实际移除它们。它们作为默认回调最有用，如果没有其他监听器处理消息。
 
                 if (res == TF_CLOSE) {
-                    cleanup_generic_listener(tf, i, glst);
+                    REGISTRY_LOCK(tf);
+                    wtbl = lst_write_begin(tf);
+                    if (wtbl->generic_listeners[i].fn == fn) {
+                        cleanup_generic_listener(wtbl, i, &wtbl->generic_listeners[i]);
+                        lst_write_commit(tf);
+                    }
+                    REGISTRY_UNLOCK(tf);
                 }
-                return;
+                return true;
             }
+
+            tbl = lst_read_begin(tf, &ticket);
         }
     }
 
-    TF_Error("未处理的消息，类型 %d", (int)msg.type);
+    lst_read_end(tf, ticket);
+
+#if TF_USE_LISTENER_TEMPLATE
+    // 最后是模板的通用监听器
+    if (tf->reg.tpl != NULL && tpl_dispatch_generic(tf, tf->reg.tpl, &msg)) return true;
+#endif
+
+    return false;
+}
+
+/**
+ * 处理由解析器刚刚收集和验证的消息
+ *
+ * @param tf - 实例
+ * @param msg_in - 准备好的消息对象（frame_id、type、data、len）
+ */
+static void _TF_FN TF_HandleReceivedMessage(TinyFrame *tf, const TF_Msg *msg_in)
+{
+    if (dispatch_message(tf, msg_in)) {
+        TF_STAT_INC(tf->rx.stats.listener_hits);
+    } else {
+        TF_STAT_INC(tf->rx.stats.listener_misses);
+        TF_REPORT(tf, TF_ERR_UNHANDLED, msg_in->type, msg_in->frame_id, "未处理的消息，类型 %d", (int)msg_in->type);
+    }
 }
 
 /** 外部续期 ID 监听器 */
@@ -528,184 +1382,413 @@ bool _TF_FN TF_RenewIdListener(TinyFrame *tf, TF_ID id)
 {
     TF_COUNT i;
     struct TF_IdListener_ *lst;
-    for (i = 0; i < tf->count_id_lst; i++) {
-        lst = &tf->id_listeners[i];
+
+    REGISTRY_LOCK(tf);
+    for (i = 0; i < tf->reg.count_id_lst; i++) {
+        lst = &tf->reg.id_listeners[i];
         // 测试是否存活且匹配
         if (lst->fn != NULL && lst->id == id) {
             renew_id_listener(lst);
+            REGISTRY_UNLOCK(tf);
             return true;
         }
     }
+    REGISTRY_UNLOCK(tf);
 
-    TF_Error("续期监听器：未找到（id %d）", (int)id);
+    TF_REPORT(tf, TF_ERR_LISTENER_NOT_FOUND, id, 0, "续期监听器：未找到（id %d）", (int)id);
     return false;
 }
 
-//endregion 监听器
+#if TF_USE_RX_POOL
 
+/** 接管当前接收缓冲区 */
+uint8_t * _TF_FN TF_TakePayload(TinyFrame *tf, TF_Msg *msg)
+{
+#if TF_USE_RX_QUEUE
+    // 帧已从解析器移交给分发。每个通道只由一个线程分发，
+    // 缓冲区指针是唯一的，所以只有当前线程的通道可能匹配。
+    uint32_t lane;
+    for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+        if (msg->data != NULL &&
+            __atomic_load_n(&tf->rx.rxq[lane].dispatch_data, __ATOMIC_RELAXED) == msg->data) {
+            __atomic_store_n(&tf->rx.rxq[lane].dispatch_data, NULL, __ATOMIC_RELAXED);
+            return (uint8_t *) msg->data;
+        }
+    }
+    TF_REPORT(tf, TF_ERR_NO_PAYLOAD, 0, 0, "没有可接管的负载缓冲区");
+    return NULL;
+#else
+    uint8_t *buf = tf->rx.data;
 
-//region 解析器
+    if (buf == NULL || msg->data != buf) {
+        TF_REPORT(tf, TF_ERR_NO_PAYLOAD, 0, 0, "没有可接管的负载缓冲区");
+        return NULL;
+    }
 
-/** 处理接收到的字节缓冲区 */
-void _TF_FN TF_Accept(TinyFrame *tf, const uint8_t *buffer, uint32_t count)
+    tf->rx.data = NULL; // 解析器复位时不再归还，下一帧会租用新的缓冲区
+    return buf;
+#endif
+}
+
+/** 归还接管的缓冲区 */
+void _TF_FN TF_ReleasePayload(TinyFrame *tf, const uint8_t *payload)
 {
-    uint32_t i;
-    for (i = 0; i < count; i++) {
-        TF_AcceptChar(tf, buffer[i]);
-    }
+    (void)tf;
+    if (payload == NULL) return;
+    rx_pool_return(payload);
 }
 
+#endif
+
+//endregion 监听器
+
+
+//region 解析器
+
 /** 重置** 解析器的内部状态。 */
 void _TF_FN TF_ResetParser(TinyFrame *tf)
 {
-    tf->state = TFState_SOF;
+    tf->rx.state = TFState_SOF;
     // 更多初始化将在接收到第一个字节时由解析器完成
+
+#if TF_USE_RX_POOL
+    if (tf->rx.data != NULL) {
+        rx_pool_return(tf->rx.data);
+        tf->rx.data = NULL;
+    }
+#endif
+}
+
+/** 帧已完整接收并验证 - 立即分发，或在队列模式下交给分发线程 */
+static void _TF_FN pars_complete_frame(TinyFrame *tf)
+{
+    TF_TRACE(frame_complete, tf, tf->rx.id, tf->rx.type, tf->rx.len);
+
+#if TF_USE_RX_QUEUE
+    // 同一类型的帧总是进入同一个通道，因此按类型保持顺序
+    uint32_t lane = (uint32_t) (tf->rx.type % TF_DISPATCH_LANES);
+    struct TF_RxQueue_ *q = &tf->rx.rxq[lane];
+    uint32_t head = q->head;
+    struct TF_RxQueueSlot_ *slot;
+
+    if (head - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == TF_RX_QUEUE_LEN) {
+        TF_REPORT(tf, TF_ERR_RX_QUEUE_FULL, lane, tf->rx.type, "接收队列已满，丢弃帧（通道 %d）", (int)lane);
+        TF_STAT_INC(tf->rx.stats.rx_dropped);
+        return; // 缓冲区由随后的 TF_ResetParser() 归还
+    }
+
+    // 丢弃的帧只计入 rx_dropped，也不进入抓包；抓包必须在缓冲区交给分发线程之前复制负载
+    TF_STAT_INC(tf->rx.stats.rx_frames);
+    capture_rx(tf);
+
+    // 缓冲区的所有权转移到队列槽
+    slot = &q->slots[head % TF_RX_QUEUE_LEN];
+    slot->id = tf->rx.id;
+    slot->type = tf->rx.type;
+    slot->len = tf->rx.len;
+    slot->data = tf->rx.data;
+    tf->rx.data = NULL;
+#if TF_USE_RX_TIMESTAMP
+    slot->rx_start = tf->rx.rx_start;
+    slot->rx_end = TF_Timestamp();
+#endif
+
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    TF_NotifyDispatch(tf, lane);
+#else
+    TF_STAT_INC(tf->rx.stats.rx_frames);
+    capture_rx(tf);
+
+    // 准备消息对象
+    TF_Msg msg;
+    TF_ClearMsg(&msg);
+    msg.frame_id = tf->rx.id;
+    msg.is_response = false;
+    msg.type = tf->rx.type;
+#if TF_USE_RX_POOL
+    msg.data = (tf->rx.data != NULL) ? tf->rx.data : rx_pool_empty;
+#else
+    msg.data = tf->rx.data;
+#endif
+    msg.len = tf->rx.len;
+#if TF_USE_RX_TIMESTAMP
+    msg.rx_start = tf->rx.rx_start;
+    msg.rx_end = TF_Timestamp();
+#endif
+
+    TF_HandleReceivedMessage(tf, &msg);
+#endif
+}
+
+#if TF_USE_RX_QUEUE
+
+/** 分发一个通道中排队的帧 */
+uint32_t _TF_FN TF_DispatchLane(TinyFrame *tf, uint32_t lane)
+{
+    struct TF_RxQueue_ *q = &tf->rx.rxq[lane];
+    uint32_t tail = q->tail;
+    uint32_t count = 0;
+    struct TF_RxQueueSlot_ *slot;
+    TF_Msg msg;
+
+    while (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+        slot = &q->slots[tail % TF_RX_QUEUE_LEN];
+
+        TF_ClearMsg(&msg);
+        msg.frame_id = slot->id;
+        msg.is_response = false;
+        msg.type = slot->type;
+        msg.data = (slot->data != NULL) ? slot->data : rx_pool_empty;
+        msg.len = slot->len;
+#if TF_USE_RX_TIMESTAMP
+        msg.rx_start = slot->rx_start;
+        msg.rx_end = slot->rx_end;
+#endif
+
+        __atomic_store_n(&q->dispatch_data, slot->data, __ATOMIC_RELAXED); // 供 TF_TakePayload() 使用
+        TF_HandleReceivedMessage(tf, &msg);
+        if (q->dispatch_data != NULL) {
+            rx_pool_return(q->dispatch_data);
+            __atomic_store_n(&q->dispatch_data, NULL, __ATOMIC_RELAXED);
+        }
+
+        // 释放槽，解析器可以再次使用它
+        tail++;
+        __atomic_store_n(&q->tail, tail, __ATOMIC_RELEASE);
+        count++;
+    }
+
+    return count;
+}
+
+/** 在调用线程中分发所有通道 */
+uint32_t _TF_FN TF_Dispatch(TinyFrame *tf)
+{
+    uint32_t lane;
+    uint32_t count = 0;
+    for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+        count += TF_DispatchLane(tf, lane);
+    }
+    return count;
 }
 
+#endif
+
+#if TF_USE_STATS
+
+/** 当前帧已经消耗的字节数（包括 SOF） */
+static uint32_t _TF_FN pars_frame_bytes(TinyFrame *tf)
+{
+#if TF_USE_SOF_BYTE
+    const uint32_t sof = 1;
+#else
+    const uint32_t sof = 0;
+#endif
+#if TF_CKSUM_TYPE == TF_CKSUM_NONE
+    const uint32_t cksum = 0;
+#else
+    const uint32_t cksum = sizeof(TF_CKSUM);
+#endif
+    const uint32_t head = sof + sizeof(TF_ID) + sizeof(TF_LEN) + sizeof(TF_TYPE) + cksum;
+
+    switch (tf->rx.state) {
+        case TFState_ID:         return sof + tf->rx.rxi;
+        case TFState_LEN:        return sof + sizeof(TF_ID) + tf->rx.rxi;
+        case TFState_TYPE:       return sof + sizeof(TF_ID) + sizeof(TF_LEN) + tf->rx.rxi;
+        case TFState_HEAD_CKSUM: return sof + sizeof(TF_ID) + sizeof(TF_LEN) + sizeof(TF_TYPE) + tf->rx.rxi;
+        case TFState_DATA:       return head + tf->rx.rxi;
+        case TFState_DATA_CKSUM: return head + tf->rx.len + tf->rx.rxi;
+        default:                 return 0;
+    }
+}
+
+/** 当前帧被丢弃 - 计入丢弃的字节（只在出错时调用） */
+#define pars_count_discarded(tf) TF_STAT_ADD((tf)->rx.stats.rx_discarded_bytes, pars_frame_bytes(tf))
+
+#else
+#define pars_count_discarded(tf) do { (void)(tf); } while (0)
+#endif
+
 /** 接收到 SOF - 为帧做准备 */
 static void _TF_FN pars_begin_frame(TinyFrame *tf) {
     // 重置状态变量
-    CKSUM_RESET(tf->cksum);
+    CKSUM_RESET(tf->rx.cksum);
 #if TF_USE_SOF_BYTE
-    CKSUM_ADD(tf->cksum, TF_SOF_BYTE);
+    CKSUM_ADD(tf->rx.cksum, TF_SOF_BYTE);
 #endif
 
-    tf->discard_data = false;
+    tf->rx.discard_data = false;
+    TF_TRACE(frame_begin, tf);
+#if TF_USE_RX_TIMESTAMP
+    tf->rx.rx_start = TF_Timestamp();
+#endif
 
     // 进入 ID 状态
-    tf->state = TFState_ID;
-    tf->rxi = 0;
+    tf->rx.state = TFState_ID;
+    tf->rx.rxi = 0;
+}
+
+/** 头部已接收（并已验证）- 准备接收负载 */
+static void _TF_FN pars_begin_data(TinyFrame *tf)
+{
+    TF_TRACE(frame_header, tf, tf->rx.id, tf->rx.type, tf->rx.len);
+
+    if (tf->rx.len == 0) {
+        // 如果消息没有主体，我们就完成了。
+        pars_complete_frame(tf);
+        TF_ResetParser(tf);
+        return;
+    }
+
+    // 进入 DATA 状态
+    tf->rx.state = TFState_DATA;
+    tf->rx.rxi = 0;
+
+    CKSUM_RESET(tf->rx.cksum); // 开始收集负载
+
+    if (tf->rx.len > TF_MAX_PAYLOAD_RX) {
+        TF_REPORT(tf, TF_ERR_OVERSIZE, tf->rx.len, TF_MAX_PAYLOAD_RX, "接收负载过长：%d > %d", (int)tf->rx.len, TF_MAX_PAYLOAD_RX);
+        TF_STAT_INC(tf->rx.stats.oversize_payloads);
+        // 错误 - 帧太长。消费但不存储。
+        tf->rx.discard_data = true;
+    }
+#if TF_USE_RX_POOL
+    else {
+        tf->rx.data = rx_pool_lease();
+        if (tf->rx.data == NULL) {
+            TF_REPORT(tf, TF_ERR_RX_POOL_EMPTY, tf->rx.len, 0, "接收缓冲池耗尽，丢弃帧");
+            TF_STAT_INC(tf->rx.stats.rx_dropped);
+            tf->rx.discard_data = true;
+        }
+    }
+#endif
 }
 
 /** 处理接收到的字符 - 这是主状态机 */
-void _TF_FN TF_AcceptChar(TinyFrame *tf, unsigned char c)
+static void _TF_FN pars_accept_char(TinyFrame *tf, uint8_t c)
 {
     // 解析器超时 - 清除
-    if (tf->parser_timeout_ticks >= TF_PARSER_TIMEOUT_TICKS) {
-        if (tf->state != TFState_SOF) {
+    if (TF_LOAD_RELAXED(tf->rx.parser_timeout_ticks) >= TF_PARSER_TIMEOUT_TICKS) {
+        if (tf->rx.state != TFState_SOF) {
+            pars_count_discarded(tf);
+            TF_STAT_INC(tf->rx.stats.parser_timeouts);
+            TF_REPORT(tf, TF_ERR_PARSER_TIMEOUT, tf->rx.state, 0, "解析器超时");
             TF_ResetParser(tf);
-            TF_Error("解析器超时");
         }
     }
-    tf->parser_timeout_ticks = 0;
+    TF_STORE_RELAXED(tf->rx.parser_timeout_ticks, 0);
 
 // DRY 代码片段 - 从输入流逐字节收集多字节数字
 // 这有点脏，但使代码更易读。使用方式例如 if()，
 // 仅在接收到整个数字（数据类型为 'type'）并存储到 'dest' 后运行主体
 #define COLLECT_NUMBER(dest, type) dest = (type)(((dest) << 8) | c); \
-                                   if (++tf->rxi == sizeof(type))
+                                   if (++tf->rx.rxi == sizeof(type))
 
 #if !TF_USE_SOF_BYTE
-    if (tf->state == TFState_SOF) {
+    if (tf->rx.state == TFState_SOF) {
         pars_begin_frame(tf);
     }
 #endif
 
     //@formatter:off
-    switch (tf->state) {
+    switch (tf->rx.state) {
         case TFState_SOF:
             if (c == TF_SOF_BYTE) {
                 pars_begin_frame(tf);
+            } else {
+                TF_STAT_INC(tf->rx.stats.rx_discarded_bytes); // 帧之间的噪声
             }
             break;
 
         case TFState_ID:
-            CKSUM_ADD(tf->cksum, c);
-            COLLECT_NUMBER(tf->id, TF_ID) {
+            CKSUM_ADD(tf->rx.cksum, c);
+            COLLECT_NUMBER(tf->rx.id, TF_ID) {
                 // 进入 LEN 状态
-                tf->state = TFState_LEN;
-                tf->rxi = 0;
+                tf->rx.state = TFState_LEN;
+                tf->rx.rxi = 0;
             }
             break;
 
         case TFState_LEN:
-            CKSUM_ADD(tf->cksum, c);
-            COLLECT_NUMBER(tf->len, TF_LEN) {
+            CKSUM_ADD(tf->rx.cksum, c);
+            COLLECT_NUMBER(tf->rx.len, TF_LEN) {
                 // 进入 TYPE 状态
-                tf->state = TFState_TYPE;
-                tf->rxi = 0;
+                tf->rx.state = TFState_TYPE;
+                tf->rx.rxi = 0;
             }
             break;
 
         case TFState_TYPE:
-            CKSUM_ADD(tf->cksum, c);
-            COLLECT_NUMBER(tf->type, TF_TYPE) {
+            CKSUM_ADD(tf->rx.cksum, c);
+            COLLECT_NUMBER(tf->rx.type, TF_TYPE) {
                 #if TF_CKSUM_TYPE == TF_CKSUM_NONE
-                    tf->state = TFState_DATA;
-                    tf->rxi = 0;
+                    pars_begin_data(tf);
                 #else
                     // 进入 HEAD_CKSUM 状态
-                    tf->state = TFState_HEAD_CKSUM;
-                    tf->rxi = 0;
-                    tf->ref_cksum = 0;
+                    tf->rx.state = TFState_HEAD_CKSUM;
+                    tf->rx.rxi = 0;
+                    tf->rx.ref_cksum = 0;
                 #endif
             }
             break;
 
         case TFState_HEAD_CKSUM:
-            COLLECT_NUMBER(tf->ref_cksum, TF_CKSUM) {
+            COLLECT_NUMBER(tf->rx.ref_cksum, TF_CKSUM) {
                 // 对照计算值检查头部校验和
-                CKSUM_FINALIZE(tf->cksum);
-
-                if (tf->cksum != tf->ref_cksum) {
-                    TF_Error("接收头部校验和不匹配");
-                    TF_ResetParser(tf);
-                    break;
-                }
+                CKSUM_FINALIZE(tf->rx.cksum);
 
-                if (tf->len == 0) {
-                    // 如果消息没有主体，我们就完成了。
-                    TF_HandleReceivedMessage(tf);
+                if (tf->rx.cksum != tf->rx.ref_cksum) {
+                    TF_REPORT(tf, TF_ERR_HEAD_CKSUM, tf->rx.ref_cksum, tf->rx.cksum, "接收头部校验和不匹配");
+                    TF_STAT_INC(tf->rx.stats.head_cksum_errors);
+                    pars_count_discarded(tf);
                     TF_ResetParser(tf);
                     break;
                 }
 
-                // 进入 DATA 状态
-                tf->state = TFState_DATA;
-                tf->rxi = 0;
-
-                CKSUM_RESET(tf->cksum); // 开始收集负载
-
-                if (tf->len > TF_MAX_PAYLOAD_RX) {
-                    TF_Error("接收负载过长：%d > %d", (int)tf->len, TF_MAX_PAYLOAD_RX);
-                    // 错误 - 帧太长。消费但不存储。
-                    tf->discard_data = true;
-                }
+                pars_begin_data(tf);
             }
             break;
 
         case TFState_DATA:
-            if (tf->discard_data) {
-                tf->rxi++;
+            if (tf->rx.discard_data) {
+                tf->rx.rxi++;
             } else {
-                CKSUM_ADD(tf->cksum, c);
-                tf->data[tf->rxi++] = c;
+                CKSUM_ADD(tf->rx.cksum, c);
+                tf->rx.data[tf->rx.rxi++] = c;
             }
 
-            if (tf->rxi == tf->len) {
+            if (tf->rx.rxi == tf->rx.len) {
                 #if TF_CKSUM_TYPE == TF_CKSUM_NONE
                     // 全部完成
-                    TF_HandleReceivedMessage(tf);
+                    if (!tf->rx.discard_data) {
+                        pars_complete_frame(tf);
+                    } else {
+                        pars_count_discarded(tf);
+                    }
                     TF_ResetParser(tf);
                 #else
                     // 进入 DATA_CKSUM 状态
-                    tf->state = TFState_DATA_CKSUM;
-                    tf->rxi = 0;
-                    tf->ref_cksum = 0;
+                    tf->rx.state = TFState_DATA_CKSUM;
+                    tf->rx.rxi = 0;
+                    tf->rx.ref_cksum = 0;
                 #endif
             }
             break;
 
         case TFState_DATA_CKSUM:
-            COLLECT_NUMBER(tf->ref_cksum, TF_CKSUM) {
+            COLLECT_NUMBER(tf->rx.ref_cksum, TF_CKSUM) {
                 // 对照计算值检查头部校验和
-                CKSUM_FINALIZE(tf->cksum);
-                if (!tf->discard_data) {
-                    if (tf->cksum == tf->ref_cksum) {
-                        TF_HandleReceivedMessage(tf);
+                CKSUM_FINALIZE(tf->rx.cksum);
+                if (!tf->rx.discard_data) {
+                    if (tf->rx.cksum == tf->rx.ref_cksum) {
+                        pars_complete_frame(tf);
                     } else {
-                        TF_Error("主体校验和不匹配");
+                        TF_REPORT(tf, TF_ERR_BODY_CKSUM, tf->rx.ref_cksum, tf->rx.cksum, "主体校验和不匹配");
+                        TF_STAT_INC(tf->rx.stats.body_cksum_errors);
+                        pars_count_discarded(tf);
                     }
+                } else {
+                    pars_count_discarded(tf);
                 }
 
                 TF_ResetParser(tf);
@@ -715,6 +1798,43 @@ void _TF_FN TF_AcceptChar(TinyFrame *tf, unsigned char c)
     //@formatter:on
 }
 
+#if TF_FULL_DUPLEX
+    // 解析器只能由一个线程运行。发现并发（或在监听器中嵌套）调用时报告并丢弃字节，
+    // 而不是破坏解析器状态。
+    #define RX_ENTER(tf) do { \
+            if (__atomic_exchange_n(&(tf)->rx.busy, 1, __ATOMIC_ACQUIRE)) { \
+                TF_REPORT(tf, TF_ERR_RX_BUSY, 0, 0, "TF_Accept 被并发调用，丢弃字节"); \
+                return; \
+            } \
+        } while (0)
+    #define RX_LEAVE(tf) __atomic_store_n(&(tf)->rx.busy, 0, __ATOMIC_RELEASE)
+#else
+    #define RX_ENTER(tf) do { (void)(tf); } while (0)
+    #define RX_LEAVE(tf) do { (void)(tf); } while (0)
+#endif
+
+/** 处理接收到的字节缓冲区 */
+void _TF_FN TF_Accept(TinyFrame *tf, const uint8_t *buffer, uint32_t count)
+{
+    uint32_t i;
+
+    RX_ENTER(tf);
+    TF_STAT_ADD(tf->rx.stats.rx_bytes, count);
+    for (i = 0; i < count; i++) {
+        pars_accept_char(tf, buffer[i]);
+    }
+    RX_LEAVE(tf);
+}
+
+/** 处理接收到的字符 */
+void _TF_FN TF_AcceptChar(TinyFrame *tf, unsigned char c)
+{
+    RX_ENTER(tf);
+    TF_STAT_INC(tf->rx.stats.rx_bytes);
+    pars_accept_char(tf, c);
+    RX_LEAVE(tf);
+}
+
 //endregion 解析器
 
 
@@ -784,7 +1904,7 @@ static inline uint32_t _TF_FN TF_ComposeHead(TinyFrame *tf, uint8_t *outbuff, TF
         id = msg->frame_id;
     }
     else {
-        id = (TF_ID) (tf->next_id++ & TF_ID_MASK);
+        id = (TF_ID) (tf->tx.next_id++ & TF_ID_MASK);
         if (tf->peer_bit) {
             id |= TF_ID_PEERBIT;
         }
@@ -832,6 +1952,7 @@ static inline uint32_t _TF_FN TF_ComposeBody(uint8_t *outbuff,
 
 #if TF_CKSUM_TYPE == TF_CKSUM_NONE
     memcpy(outbuff, data, data_len);
+    pos = data_len;
 #else
     for (i = 0; i < data_len; i++) {
         b = data[i];
@@ -863,6 +1984,16 @@ static inline uint32_t _TF_FN TF_ComposeTail(uint8_t *outbuff, TF_CKSUM *cksum)
     return pos;
 }
 
+/** 将发送缓冲区中的内容交给 TF_WriteImpl() */
+static inline void _TF_FN tx_flush(TinyFrame *tf)
+{
+    TF_STAT_ADD(tf->tx.stats.tx_bytes, tf->tx.pos);
+    TF_TRACE(tx_flush_begin, tf, tf->tx.pos);
+    TF_WriteImpl(tf, (const uint8_t *) tf->tx.sendbuf, tf->tx.pos);
+    TF_TRACE(tx_flush_end, tf);
+    tf->tx.pos = 0;
+}
+
 /**
  * 开始构建和发送帧
  *
@@ -875,19 +2006,33 @@ static inline uint32_t _TF_FN TF_ComposeTail(uint8_t *outbuff, TF_CKSUM *cksum)
  */
 static bool _TF_FN TF_SendFrame_Begin(TinyFrame *tf, TF_Msg *msg, TF_Listener listener, TF_Listener_Timeout ftimeout, TF_TICKS timeout)
 {
-    TF_TRY(TF_ClaimTx(tf));
+    // 查询的延迟包括等待发送锁的时间
+    uint64_t sent_at = listener ? latency_now() : 0;
+    bool claimed;
+
+    TF_TRACE(tx_claim_begin, tf);
+    claimed = TF_ClaimTx(tf);
+    TF_TRACE(tx_claim_end, tf, claimed);
+    TF_TRY(claimed);
+
+    if (!sendbuf_acquire(tf)) {
+        TF_ReleaseTx(tf);
+        return false;
+    }
 
-    tf->tx_pos = (uint32_t) TF_ComposeHead(tf, tf->sendbuf, msg); // 如果不是响应，帧 ID 在此处递增
-    tf->tx_len = msg->len;
+    tf->tx.pos = (uint32_t) TF_ComposeHead(tf, tf->tx.sendbuf, msg); // 如果不是响应，帧 ID 在此处递增
+    tf->tx.len = msg->len;
 
     if (listener) {
-        if(!TF_AddIdListener(tf, msg, listener, ftimeout, timeout)) {
+        if(!add_id_listener(tf, msg, listener, ftimeout, timeout, sent_at, true)) {
+            sendbuf_release(tf);
             TF_ReleaseTx(tf);
             return false;
         }
     }
 
-    CKSUM_RESET(tf->tx_cksum);
+    capture_tx_begin(tf, msg);
+    CKSUM_RESET(tf->tx.cksum);
     return true;
 }
 
@@ -905,18 +2050,19 @@ static void _TF_FN TF_SendFrame_Chunk(TinyFrame *tf, const uint8_t *buff, uint32
     uint32_t chunk;
     uint32_t sent = 0;
 
+    capture_tx_chunk(tf, buff, length);
+
     remain = length;
     while (remain > 0) {
         // 写入能放入 tx 缓冲区的内容
-        chunk = TF_MIN(TF_SENDBUF_LEN - tf->tx_pos, remain);
-        tf->tx_pos += TF_ComposeBody(tf->sendbuf+tf->tx_pos, buff+sent, (TF_LEN) chunk, &tf->tx_cksum);
+        chunk = TF_MIN(TF_SENDBUF_LEN - tf->tx.pos, remain);
+        tf->tx.pos += TF_ComposeBody(tf->tx.sendbuf+tf->tx.pos, buff+sent, (TF_LEN) chunk, &tf->tx.cksum);
         remain -= chunk;
         sent += chunk;
 
         // 如果缓冲区满则刷新
-        if (tf->tx_pos == TF_SENDBUF_LEN) {
-            TF_WriteImpl(tf, (const uint8_t *) tf->sendbuf, tf->tx_pos);
-            tf->tx_pos = 0;
+        if (tf->tx.pos == TF_SENDBUF_LEN) {
+            tx_flush(tf);
         }
     }
 }
@@ -929,18 +2075,20 @@ static void _TF_FN TF_SendFrame_Chunk(TinyFrame *tf, const uint8_t *buff, uint32
 static void _TF_FN TF_SendFrame_End(TinyFrame *tf)
 {
     // 仅当消息有主体时才校验和
-    if (tf->tx_len > 0) {
+    if (tf->tx.len > 0) {
         // 如果校验和无法放入缓冲区则刷新
-        if (TF_SENDBUF_LEN - tf->tx_pos < sizeof(TF_CKSUM)) {
-            TF_WriteImpl(tf, (const uint8_t *) tf->sendbuf, tf->tx_pos);
-            tf->tx_pos = 0;
+        if (TF_SENDBUF_LEN - tf->tx.pos < sizeof(TF_CKSUM)) {
+            tx_flush(tf);
         }
 
         // 添加校验和，刷新剩余要发送的内容
-        tf->tx_pos += TF_ComposeTail(tf->sendbuf + tf->tx_pos, &tf->tx_cksum);
+        tf->tx.pos += TF_ComposeTail(tf->tx.sendbuf + tf->tx.pos, &tf->tx.cksum);
     }
 
-    TF_WriteImpl(tf, (const uint8_t *) tf->sendbuf, tf->tx_pos);
+    TF_STAT_INC(tf->tx.stats.tx_frames);
+    tx_flush(tf);
+    capture_tx_end(tf);
+    sendbuf_release(tf);
     TF_ReleaseTx(tf);
 }
 
@@ -1064,24 +2212,224 @@ void _TF_FN TF_Tick(TinyFrame *tf)
 {
     TF_COUNT i;
     struct TF_IdListener_ *lst;
+    struct TF_IdListener_ expired;
+    uint64_t now;
 
     // 增加解析器超时（超时在接收下一个字节时处理）
-    if (tf->parser_timeout_ticks < TF_PARSER_TIMEOUT_TICKS) {
-        tf->parser_timeout_ticks++;
+    // 计数器与接收线程共享，丢失一次递增没有影响
+    if (TF_LOAD_RELAXED(tf->rx.parser_timeout_ticks) < TF_PARSER_TIMEOUT_TICKS) {
+        TF_STORE_RELAXED(tf->rx.parser_timeout_ticks, (TF_TICKS) (tf->rx.parser_timeout_ticks + 1));
+    }
+
+#if TF_USE_ERROR_CALLBACK
+    // 推进错误限流的时间窗口（只有调用 TF_Tick() 的线程写入 ticks）
+    if (++tf->err.ticks >= TF_ERROR_WINDOW_TICKS) {
+        tf->err.ticks = 0;
+        TF_STORE_RELAXED(tf->err.window, tf->err.window + 1);
     }
+#endif
 
-    // 递减并使 ID 监听器过期
-    for (i = 0; i < tf->count_id_lst; i++) {
-        lst = &tf->id_listeners[i];
+    // 递减并使 ID 监听器过期。持有锁时不调用任何用户代码（错误回调、TF_Timestamp()、跟踪点），
+    // 超时的时间在获取锁之前读取，报告在释放锁之后进行
+    now = latency_now();
+    REGISTRY_LOCK(tf);
+    for (i = 0; i < tf->reg.count_id_lst; i++) {
+        lst = &tf->reg.id_listeners[i];
         if (!lst->fn || lst->timeout == 0) continue;
         // 倒计时...
         if (--lst->timeout == 0) {
-            TF_Error("ID 监听器 %d 已过期", (int)lst->id);
-            if (lst->fn_timeout != NULL) {
-                lst->fn_timeout(tf); // 执行超时函数
+            TF_STAT_INC(tf->reg.stats.expired_listeners);
+            latency_timeout(tf, lst, now);
+            // 监听器已过期 - 释放槽，然后在锁外报告并运行回调
+            expired = *lst;
+            release_id_listener(tf, i, lst);
+            REGISTRY_UNLOCK(tf);
+
+            TF_REPORT(tf, TF_ERR_ID_LISTENER_EXPIRED, expired.id, 0, "ID 监听器 %d 已过期", (int)expired.id);
+            TF_TRACE(id_listener_expire, tf, expired.id);
+
+            if (expired.fn_timeout != NULL) {
+                expired.fn_timeout(tf); // 执行超时函数
+            }
+            notify_id_listener_cleanup(tf, &expired);
+
+            REGISTRY_LOCK(tf);
+        }
+    }
+    REGISTRY_UNLOCK(tf);
+}
+
+
+//region 统计
+
+#if TF_USE_STATS
+
+/** 读取统计计数器的快照 */
+void _TF_FN TF_GetStats(TinyFrame *tf, TF_Stats *out)
+{
+    out->rx_frames = TF_LOAD_RELAXED(tf->rx.stats.rx_frames);
+    out->rx_bytes = TF_LOAD_RELAXED(tf->rx.stats.rx_bytes);
+    out->rx_discarded_bytes = TF_LOAD_RELAXED(tf->rx.stats.rx_discarded_bytes);
+    out->rx_dropped = TF_LOAD_RELAXED(tf->rx.stats.rx_dropped);
+    out->head_cksum_errors = TF_LOAD_RELAXED(tf->rx.stats.head_cksum_errors);
+    out->body_cksum_errors = TF_LOAD_RELAXED(tf->rx.stats.body_cksum_errors);
+    out->parser_timeouts = TF_LOAD_RELAXED(tf->rx.stats.parser_timeouts);
+    out->oversize_payloads = TF_LOAD_RELAXED(tf->rx.stats.oversize_payloads);
+    out->listener_hits = TF_LOAD_RELAXED(tf->rx.stats.listener_hits);
+    out->listener_misses = TF_LOAD_RELAXED(tf->rx.stats.listener_misses);
+    out->rx_queued = 0;
+#if TF_USE_RX_QUEUE
+    {
+        uint32_t lane, tail, queued;
+        for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+            // 先读 tail：tail 不会超过 head，之后读到的 head 只会更大，差值不会下溢。
+            // 两次读取之间可能又入队和出队了帧，因此限制在通道容量以内。
+            tail = __atomic_load_n(&tf->rx.rxq[lane].tail, __ATOMIC_ACQUIRE);
+            queued = __atomic_load_n(&tf->rx.rxq[lane].head, __ATOMIC_ACQUIRE) - tail;
+            out->rx_queued += (queued > TF_RX_QUEUE_LEN) ? TF_RX_QUEUE_LEN : queued;
+        }
+    }
+#endif
+
+    out->tx_frames = TF_LOAD_RELAXED(tf->tx.stats.tx_frames);
+    out->tx_bytes = TF_LOAD_RELAXED(tf->tx.stats.tx_bytes);
+
+    out->expired_listeners = TF_LOAD_RELAXED(tf->reg.stats.expired_listeners);
+    out->id_listeners_inflight = TF_LOAD_RELAXED(tf->reg.stats.id_listeners_inflight);
+    out->id_listeners_peak = TF_LOAD_RELAXED(tf->reg.stats.id_listeners_peak);
+}
+
+/** 将计数器清零（峰值重置为当前值） */
+void _TF_FN TF_ResetStats(TinyFrame *tf)
+{
+    // 与写者并发时可能有个别递增丢失或残留，这对统计没有影响
+    TF_STORE_RELAXED(tf->rx.stats.rx_frames, 0);
+    TF_STORE_RELAXED(tf->rx.stats.rx_bytes, 0);
+    TF_STORE_RELAXED(tf->rx.stats.rx_discarded_bytes, 0);
+    TF_STORE_RELAXED(tf->rx.stats.rx_dropped, 0);
+    TF_STORE_RELAXED(tf->rx.stats.head_cksum_errors, 0);
+    TF_STORE_RELAXED(tf->rx.stats.body_cksum_errors, 0);
+    TF_STORE_RELAXED(tf->rx.stats.parser_timeouts, 0);
+    TF_STORE_RELAXED(tf->rx.stats.oversize_payloads, 0);
+    TF_STORE_RELAXED(tf->rx.stats.listener_hits, 0);
+    TF_STORE_RELAXED(tf->rx.stats.listener_misses, 0);
+
+    TF_STORE_RELAXED(tf->tx.stats.tx_frames, 0);
+    TF_STORE_RELAXED(tf->tx.stats.tx_bytes, 0);
+
+    REGISTRY_LOCK(tf);
+    TF_STORE_RELAXED(tf->reg.stats.expired_listeners, 0);
+    TF_STORE_RELAXED(tf->reg.stats.id_listeners_peak, tf->reg.stats.id_listeners_inflight);
+    REGISTRY_UNLOCK(tf);
+}
+
+#endif
+
+//endregion 统计
+
+
+//region 查询延迟
+
+#if TF_USE_LATENCY
+
+/** 直方图中第 rank 个（从 1 开始）值所在桶的上界（调用者持有注册表锁） */
+static uint64_t _TF_FN latency_rank(const struct TF_LatencyHist_ *h, uint64_t rank)
+{
+    uint32_t i, group;
+    uint64_t seen = 0, upper = h->max;
+
+    for (i = 0; i < TF_LATENCY_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            group = i >> TF_LATENCY_SUB_BITS;
+            if (group == 0) {
+                upper = i;
+            } else {
+                upper = ((uint64_t) ((1u << TF_LATENCY_SUB_BITS) + (i & ((1u << TF_LATENCY_SUB_BITS) - 1))) << (group - 1))
+                        + ((uint64_t) 1 << (group - 1)) - 1;
             }
-            // 监听器已过期
-            cleanup_id_listener(tf, i, lst);
+            break;
         }
     }
+
+    // 桶的边界可能超出实际记录的范围
+    if (upper > h->max) upper = h->max;
+    if (upper < h->min) upper = h->min;
+    return upper;
+}
+
+/** 百万分位对应的排名 */
+static inline uint64_t _TF_FN latency_ppm_rank(const struct TF_LatencyHist_ *h, uint32_t ppm)
+{
+    uint64_t rank = ((uint64_t) h->count * ppm + 999999) / 1000000;
+    return rank == 0 ? 1 : rank;
+}
+
+/** 读取一个查询类型的延迟摘要 */
+bool _TF_FN TF_GetLatency(TinyFrame *tf, TF_TYPE type, TF_LatencySummary *out)
+{
+    const struct TF_LatencyHist_ *h;
+
+    REGISTRY_LOCK(tf);
+    h = latency_hist(tf, type, false);
+    if (h == NULL || h->count == 0) {
+        REGISTRY_UNLOCK(tf);
+        memset(out, 0, sizeof(TF_LatencySummary));
+        return false;
+    }
+
+    out->count = h->count;
+    out->timeouts = h->timeouts;
+    out->min = h->min;
+    out->max = h->max;
+    out->mean = h->sum / h->count;
+    out->p50 = latency_rank(h, latency_ppm_rank(h, 500000));
+    out->p90 = latency_rank(h, latency_ppm_rank(h, 900000));
+    out->p99 = latency_rank(h, latency_ppm_rank(h, 990000));
+    out->p999 = latency_rank(h, latency_ppm_rank(h, 999000));
+    REGISTRY_UNLOCK(tf);
+    return true;
+}
+
+/** 读取一个查询类型的任意百分位数 */
+uint64_t _TF_FN TF_LatencyPercentile(TinyFrame *tf, TF_TYPE type, uint32_t ppm)
+{
+    const struct TF_LatencyHist_ *h;
+    uint64_t v = 0;
+
+    if (ppm > 1000000) ppm = 1000000;
+
+    REGISTRY_LOCK(tf);
+    h = latency_hist(tf, type, false);
+    if (h != NULL && h->count > 0) {
+        v = latency_rank(h, latency_ppm_rank(h, ppm));
+    }
+    REGISTRY_UNLOCK(tf);
+    return v;
+}
+
+/** 列出有记录的查询类型 */
+uint32_t _TF_FN TF_LatencyTypes(TinyFrame *tf, TF_TYPE *types, uint32_t max)
+{
+    uint32_t i, n;
+
+    REGISTRY_LOCK(tf);
+    n = TF_MIN(tf->reg.latency.count, max);
+    for (i = 0; i < n; i++) {
+        types[i] = tf->reg.latency.types[i];
+    }
+    REGISTRY_UNLOCK(tf);
+    return n;
+}
+
+/** 清除所有延迟记录 */
+void _TF_FN TF_ResetLatency(TinyFrame *tf)
+{
+    REGISTRY_LOCK(tf);
+    memset(&tf->reg.latency, 0, sizeof(struct TF_LatencyTable_));
+    REGISTRY_UNLOCK(tf);
 }
+
+#endif
+
+//endregion 查询延迟
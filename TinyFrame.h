@@ -31,6 +31,10 @@
 
 #include "TF_Config.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 //region 解析数据类型
 
 #if TF_LEN_BYTES == 1
@@ -40,7 +44,7 @@
 #elif TF_LEN_BYTES == 4
     typedef uint32_t TF_LEN;
 #else
-    #error TF_LEN_BYTES 的值错误，必须是 1、2 或 4
+    #error "TF_LEN_BYTES 的值错误，必须是 1、2 或 4"
 #endif
 
 
@@ -51,7 +55,7 @@
 #elif TF_TYPE_BYTES == 4
     typedef uint32_t TF_TYPE;
 #else
-    #error TF_TYPE_BYTES 的值错误，必须是 1、2 或 4
+    #error "TF_TYPE_BYTES 的值错误，必须是 1、2 或 4"
 #endif
 
 
@@ -62,7 +66,7 @@
 #elif TF_ID_BYTES == 4
     typedef uint32_t TF_ID;
 #else
-    #error TF_ID_BYTES 的值错误，必须是 1、2 或 4
+    #error "TF_ID_BYTES 的值错误，必须是 1、2 或 4"
 #endif
 
 
@@ -76,11 +80,141 @@
     // CRC32
     typedef uint32_t TF_CKSUM;
 #else
-    #error TF_CKSUM_TYPE 的值错误
+    #error "TF_CKSUM_TYPE 的值错误"
 #endif
 
 //endregion
 
+#if TF_USE_RX_POOL
+    #if !defined(TF_RX_POOL_SLABS) || (TF_RX_POOL_SLABS < 1)
+        #error "使用 TF_USE_RX_POOL 时必须将 TF_RX_POOL_SLABS 定义为正数"
+    #endif
+#endif
+
+#if TF_USE_RX_QUEUE
+    #if !TF_USE_RX_POOL
+        #error "TF_USE_RX_QUEUE 需要 TF_USE_RX_POOL（排队的帧持有从池中租用的缓冲区）"
+    #endif
+    #if !defined(TF_RX_QUEUE_LEN) || (TF_RX_QUEUE_LEN < 2) || (TF_RX_QUEUE_LEN & (TF_RX_QUEUE_LEN - 1))
+        #error "使用 TF_USE_RX_QUEUE 时必须将 TF_RX_QUEUE_LEN 定义为 2 的幂（至少为 2）"
+    #endif
+    #ifndef TF_DISPATCH_LANES
+        #define TF_DISPATCH_LANES 1
+    #endif
+    #if (TF_DISPATCH_LANES > 1) && !TF_USE_REGISTRY_LOCK
+        #error "多个分发通道并行运行监听器，需要 TF_USE_REGISTRY_LOCK"
+    #endif
+#endif
+
+#if TF_FULL_DUPLEX
+    #if !TF_USE_MUTEX || !TF_USE_REGISTRY_LOCK
+        #error "TF_FULL_DUPLEX 需要 TF_USE_MUTEX 和 TF_USE_REGISTRY_LOCK"
+    #endif
+#endif
+
+#if TF_USE_LISTENER_TEMPLATE
+    #ifndef TF_MAX_TEMPLATE_TYPE_LST
+        #error "使用 TF_USE_LISTENER_TEMPLATE 时必须定义 TF_MAX_TEMPLATE_TYPE_LST"
+    #endif
+    #ifndef TF_MAX_TEMPLATE_GEN_LST
+        #define TF_MAX_TEMPLATE_GEN_LST TF_MAX_GEN_LST
+    #endif
+#endif
+
+#if TF_USE_RCU_LISTENERS
+    #if !TF_USE_REGISTRY_LOCK
+        #error "TF_USE_RCU_LISTENERS 需要 TF_USE_REGISTRY_LOCK（用于串行化写者）"
+    #endif
+    #ifndef TF_RCU_RELAX
+        // 写者等待宽限期时在每次轮询之间调用（例如让出 CPU）
+        #define TF_RCU_RELAX() do {} while (0)
+    #endif
+#endif
+
+#if TF_USE_ERROR_CALLBACK
+    #ifndef TF_ERROR_BURST
+        // 每个错误码在一个时间窗口内最多报告的次数
+        #define TF_ERROR_BURST 5
+    #endif
+    #ifndef TF_ERROR_WINDOW_TICKS
+        // 限流时间窗口的长度（TF_Tick() 调用次数）
+        #define TF_ERROR_WINDOW_TICKS 1000
+    #endif
+#endif
+
+#if TF_USE_CAPTURE
+    #ifndef TF_CAPTURE_SLOTS
+        #define TF_CAPTURE_SLOTS 64
+    #endif
+    #if (TF_CAPTURE_SLOTS < 2) || (TF_CAPTURE_SLOTS & (TF_CAPTURE_SLOTS - 1))
+        #error "TF_CAPTURE_SLOTS 必须是 2 的幂（至少为 2）"
+    #endif
+    #ifndef TF_CAPTURE_SNAPLEN
+        // 每帧保存的最大负载字节数，更长的负载被截断
+        #define TF_CAPTURE_SNAPLEN 64
+    #endif
+#endif
+
+#if TF_USE_LATENCY
+    #ifndef TF_LATENCY_TYPES
+        // 分别记录直方图的查询类型数量，更多的类型不记录
+        #define TF_LATENCY_TYPES 8
+    #endif
+    #ifndef TF_LATENCY_SUB_BITS
+        // 每个 2 的幂区间分成 2^TF_LATENCY_SUB_BITS 个桶（4 = 相对误差不超过 1/16）
+        #define TF_LATENCY_SUB_BITS 4
+    #endif
+    #ifndef TF_LATENCY_MAX_BITS
+        // 可以区分的最大延迟为 2^TF_LATENCY_MAX_BITS 个时间单位，更大的值计入最后一个桶
+        #define TF_LATENCY_MAX_BITS 36
+    #endif
+    #if (TF_LATENCY_SUB_BITS < 1) || (TF_LATENCY_MAX_BITS <= TF_LATENCY_SUB_BITS) || (TF_LATENCY_MAX_BITS > 63)
+        #error "TF_LATENCY_SUB_BITS 和 TF_LATENCY_MAX_BITS 的取值无效"
+    #endif
+    #define TF_LATENCY_BUCKETS ((TF_LATENCY_MAX_BITS - TF_LATENCY_SUB_BITS + 1) << TF_LATENCY_SUB_BITS)
+#endif
+
+/*
+ * 跟踪点。在帧的生命周期中的以下位置调用 TF_TRACE(probe, 参数...)：
+ *
+ *   frame_begin(tf)                      解析器看到帧的第一个字节（SOF）
+ *   frame_header(tf, id, type, len)      帧头通过校验
+ *   frame_complete(tf, id, type, len)    负载接收完成并通过校验
+ *   dispatch_begin(tf, kind, type)       调用监听器之前，kind 为 TF_TraceListenerKind
+ *   dispatch_end(tf, kind, result)       监听器返回之后，result 为 TF_Result
+ *   tx_claim_begin(tf)                   开始获取发送锁（TF_ClaimTx）
+ *   tx_claim_end(tf, ok)                 获取发送锁之后
+ *   tx_flush_begin(tf, len)              调用 TF_WriteImpl() 之前
+ *   tx_flush_end(tf)                     TF_WriteImpl() 返回之后
+ *   id_listener_expire(tf, id)           ID 监听器超时
+ *
+ * 默认情况下 TF_TRACE 为空，参数不会被求值。设置 TF_USE_USDT 为 1 时，跟踪点成为
+ * provider 为 "tinyframe" 的 USDT 探针（需要 <sys/sdt.h>），perf 和 bpftrace 可以在运行中的程序上挂接；
+ * 也可以在配置文件中自行定义 TF_TRACE，例如转发到 LTTng 的 tracepoint() 或其他跟踪器。
+ */
+#if TF_USE_USDT
+    #ifdef TF_TRACE
+        #error "TF_USE_USDT 与自定义的 TF_TRACE 不能同时使用"
+    #endif
+    #define TF_TRACE(probe, ...) STAP_PROBEV(tinyframe, probe, ##__VA_ARGS__)
+#elif !defined(TF_TRACE)
+    #define TF_TRACE(probe, ...) do { } while (0)
+#endif
+
+#if defined(TF_CACHE_LINE) && (TF_CACHE_LINE > 0)
+    // 将接收、发送和注册表状态分别放在不同的缓存行上
+    #define TF_CACHE_ALIGNED __attribute__((aligned(TF_CACHE_LINE)))
+#else
+    #define TF_CACHE_ALIGNED
+#endif
+
+#if TF_USE_SHARED_SENDBUF
+    #ifndef TF_THREAD_LOCAL
+        // 共享发送缓冲区的存储类别。如果所有实例都由同一个事件循环线程驱动，可以定义为空。
+        #define TF_THREAD_LOCAL __thread
+    #endif
+#endif
+
 //---------------------------------------------------------------------------
 
 /** 对方位枚举 (用于初始化) */
@@ -98,6 +232,40 @@ typedef enum {
     TF_CLOSE = 3,  //!< 已处理，移除自身
 } TF_Result;
 
+/** 跟踪点 dispatch_begin 和 dispatch_end 中的监听器类别 */
+typedef enum {
+    TF_TRACE_ID_LISTENER = 0,
+    TF_TRACE_TYPE_LISTENER = 1,
+    TF_TRACE_GENERIC_LISTENER = 2,
+    TF_TRACE_TEMPLATE_TYPE_LISTENER = 3,    //!< 共享模板中的类型监听器
+    TF_TRACE_TEMPLATE_GENERIC_LISTENER = 4, //!< 共享模板中的通用监听器
+} TF_TraceListenerKind;
+
+
+/** 错误码，用于 TF_USE_ERROR_CALLBACK 模式（注释中为回调收到的参数） */
+typedef enum {
+    TF_ERR_TX_BUSY = 0,           //!< 发送接口已被锁定（未启用 TF_USE_MUTEX）
+    TF_ERR_SENDBUF_BUSY,          //!< 共享发送缓冲区正被另一个实例使用
+    TF_ERR_NULL_ARG,              //!< 初始化函数收到空指针
+    TF_ERR_NO_MEMORY,             //!< 内存不足（arg1 = 请求的大小）
+    TF_ERR_TEMPLATE,              //!< 模板已冻结、已满或未冻结（arg1 = 类型）
+    TF_ERR_ID_LISTENER_FULL,      //!< 没有空闲的 ID 监听器槽（arg1 = 帧 ID）
+    TF_ERR_TYPE_LISTENER_FULL,    //!< 没有空闲的类型监听器槽（arg1 = 类型）
+    TF_ERR_GENERIC_LISTENER_FULL, //!< 没有空闲的通用监听器槽
+    TF_ERR_LISTENER_NOT_FOUND,    //!< 要移除或续期的监听器不存在（arg1 = ID 或类型）
+    TF_ERR_UNHANDLED,             //!< 没有监听器处理消息（arg1 = 类型，arg2 = 帧 ID）
+    TF_ERR_NO_PAYLOAD,            //!< TF_TakePayload() 没有可接管的缓冲区
+    TF_ERR_RX_QUEUE_FULL,         //!< 接收队列已满，丢弃帧（arg1 = 通道，arg2 = 类型）
+    TF_ERR_OVERSIZE,              //!< 负载过长（arg1 = 长度，arg2 = TF_MAX_PAYLOAD_RX）
+    TF_ERR_RX_POOL_EMPTY,         //!< 接收缓冲池耗尽，丢弃帧（arg1 = 长度）
+    TF_ERR_PARSER_TIMEOUT,        //!< 解析器超时（arg1 = 解析器状态）
+    TF_ERR_HEAD_CKSUM,            //!< 头部校验和不匹配（arg1 = 收到的，arg2 = 计算的）
+    TF_ERR_BODY_CKSUM,            //!< 主体校验和不匹配（arg1 = 收到的，arg2 = 计算的）
+    TF_ERR_RX_BUSY,               //!< TF_Accept() 被并发调用，丢弃字节
+    TF_ERR_ID_LISTENER_EXPIRED,   //!< ID 监听器超时（arg1 = 帧 ID）
+    TF_ERR__COUNT                 //!< 错误码数量（不是错误码）
+} TF_ErrorCode;
+
 
 /** 用于发送/接收消息的数据结构 */
 typedef struct TF_Msg_ {
@@ -124,6 +292,18 @@ typedef struct TF_Msg_ {
      */
     void *userdata;
     void *userdata2;
+
+#if TF_USE_RX_TIMESTAMP
+    /**
+     * 接收的帧的时间戳（TF_Timestamp()），发送时忽略。
+     *
+     * rx_start 是帧的第一个字节（SOF，或者没有 SOF 时的 ID）被解析的时间，rx_end 是校验和通过的时间。
+     * rx_end - rx_start 是帧在线路上的时间，分发时的当前时间减去 rx_end 是帧等待分发的时间
+     * （例如在接收队列中）。精度受 TF_Accept() 的调用粒度限制：同一次调用中的字节具有相同的到达时间。
+     */
+    uint64_t rx_start;
+    uint64_t rx_end;
+#endif
 } TF_Msg;
 
 /**
@@ -139,6 +319,11 @@ static inline void TF_ClearMsg(TF_Msg *msg)
 /** TinyFrame 结构体类型定义 */
 typedef struct TinyFrame_ TinyFrame;
 
+#if TF_USE_LISTENER_TEMPLATE
+/** 监听器模板类型定义 */
+typedef struct TF_ListenerTemplate_ TF_ListenerTemplate;
+#endif
+
 /**
  * TinyFrame 类型监听器回调
  *
@@ -213,6 +398,37 @@ void TF_Accept(TinyFrame *tf, const uint8_t *buffer, uint32_t count);
  */
 void TF_AcceptChar(TinyFrame *tf, uint8_t c);
 
+#if TF_USE_RX_QUEUE
+
+/**
+ * 分发一个通道中由解析器排队的帧（运行监听器）。
+ *
+ * 在 TF_USE_RX_QUEUE 模式下，TF_Accept() 不直接运行监听器，而是把完整的帧放入
+ * 通道 (type % TF_DISPATCH_LANES) 的队列并调用 TF_NotifyDispatch()。
+ * 此函数应在工作线程中调用，按接收顺序处理该通道中的所有帧，解析器同时可以继续接收下一帧。
+ *
+ * 每个通道同一时间只能由一个线程分发；不同通道可以由不同线程并行分发，
+ * 因此同一类型的帧按顺序处理，不同类型的帧并行处理。
+ * 如果 TF_DISPATCH_LANES > 1，监听器表由 TF_ClaimRegistry() / TF_ReleaseRegistry() 保护，
+ * 工作线程中可以调用 TF_Respond() 等发送函数（需要 TF_USE_MUTEX 和真正的互斥锁）。
+ *
+ * @param tf - 实例
+ * @param lane - 通道编号（0 .. TF_DISPATCH_LANES-1）
+ * @return 分发的帧数
+ */
+uint32_t TF_DispatchLane(TinyFrame *tf, uint32_t lane);
+
+/**
+ * 在调用线程中依次分发所有通道的排队帧。
+ * 用于只有一个分发线程的情况。
+ *
+ * @param tf - 实例
+ * @return 分发的帧数
+ */
+uint32_t TF_Dispatch(TinyFrame *tf);
+
+#endif
+
 /**
  * 此函数应定期调用。
  * 时间基准用于超时解析器中的部分帧并自动重置它。
@@ -227,6 +443,7 @@ void TF_Tick(TinyFrame *tf);
 /**
  * 重置帧解析器状态机。
  * 这不影响已注册的监听器。
+ * 启用 TF_USE_RX_POOL 时，正在使用的接收缓冲区会被归还到共享池。
  *
  * @param tf - 实例
  */
@@ -300,6 +517,113 @@ bool TF_RemoveGenericListener(TinyFrame *tf, TF_Listener cb);
 bool TF_RenewIdListener(TinyFrame *tf, TF_ID id);
 
 
+#if TF_USE_RX_POOL
+
+/**
+ * 在监听器中接管当前接收缓冲区的所有权，避免为延迟处理复制负载。
+ *
+ * 缓冲区从解析器分离，msg->data 在回调返回后仍然有效；
+ * 解析器会为下一帧从池中租用新的缓冲区。仅在 TF_USE_RX_POOL 模式下可用。
+ *
+ * @param tf - 实例
+ * @param msg - 传递给监听器的消息
+ * @return 负载缓冲区（即 msg->data），之后必须用 TF_ReleasePayload() 归还；
+ *         空帧或不在监听器回调中时返回 NULL
+ */
+uint8_t *TF_TakePayload(TinyFrame *tf, TF_Msg *msg);
+
+/**
+ * 归还通过 TF_TakePayload() 接管的负载缓冲区。
+ * 可以从任何线程调用。
+ *
+ * @param tf - 实例
+ * @param payload - TF_TakePayload() 返回的缓冲区（NULL 被忽略）
+ */
+void TF_ReleasePayload(TinyFrame *tf, const uint8_t *payload);
+
+#endif
+
+#if TF_USE_LISTENER_TEMPLATE
+
+// ---------------------------- 监听器模板 -------------------------------
+
+/**
+ * 初始化静态分配的监听器模板（空，未冻结）。
+ *
+ * 模板是一组类型和通用监听器，构建一次后冻结，然后通过引用附加到任意多个实例，
+ * 而不必在每个实例中注册相同的监听器。
+ *
+ * @param tpl - 模板
+ * @return 成功
+ */
+bool TF_TemplateInitStatic(TF_ListenerTemplate *tpl);
+
+/**
+ * 使用 malloc() 创建监听器模板。
+ *
+ * @return 模板或 NULL
+ */
+TF_ListenerTemplate *TF_TemplateInit(void);
+
+/**
+ * 释放动态分配的模板。不能在仍有实例使用它时调用。
+ *
+ * @param tpl - 模板
+ */
+void TF_TemplateDeInit(TF_ListenerTemplate *tpl);
+
+/**
+ * 向模板添加类型监听器（仅在冻结之前）。
+ * 同一类型的多个监听器按添加顺序运行，直到其中一个不返回 TF_NEXT。
+ *
+ * @param tpl - 模板
+ * @param frame_type - 要监听的帧类型
+ * @param cb - 回调
+ * @return 成功
+ */
+bool TF_TemplateAddTypeListener(TF_ListenerTemplate *tpl, TF_TYPE frame_type, TF_Listener cb);
+
+/**
+ * 向模板添加通用监听器（仅在冻结之前）。
+ *
+ * @param tpl - 模板
+ * @param cb - 回调
+ * @return 成功
+ */
+bool TF_TemplateAddGenericListener(TF_ListenerTemplate *tpl, TF_Listener cb);
+
+/**
+ * 冻结模板：按类型排序以便二分查找，之后模板不可修改，可以被多个线程中的实例共享。
+ *
+ * @param tpl - 模板
+ */
+void TF_TemplateFreeze(TF_ListenerTemplate *tpl);
+
+/**
+ * 使用静态分配的实例结构体初始化 TinyFrame 引擎，并附加冻结的模板。
+ *
+ * 实例自己的监听器（用 TF_AddTypeListener() 等添加）作为覆盖优先运行：
+ * 顺序为 ID 监听器、实例的类型监听器、模板的类型监听器、实例的通用监听器、模板的通用监听器。
+ * 模板监听器返回 TF_CLOSE 时等同于 TF_STAY（模板不可修改）。
+ *
+ * @param tf - 实例
+ * @param peer_bit - 用于自身的对方位
+ * @param tpl - 冻结的模板，必须比实例存活更久
+ * @return 成功
+ */
+bool TF_InitStaticFromTemplate(TinyFrame *tf, TF_Peer peer_bit, const TF_ListenerTemplate *tpl);
+
+/**
+ * 使用 malloc() 获取实例并附加冻结的模板，参见 TF_InitStaticFromTemplate()。
+ *
+ * @param peer_bit - 用于自身的对方位
+ * @param tpl - 冻结的模板，必须比实例存活更久
+ * @return TF 实例或 NULL
+ */
+TinyFrame *TF_InitFromTemplate(TF_Peer peer_bit, const TF_ListenerTemplate *tpl);
+
+#endif
+
 // ---------------------------- 帧发送函数 ------------------------------
 
 /**
@@ -391,10 +715,242 @@ void TF_Multipart_Payload(TinyFrame *tf, const uint8_t *buff, uint32_t length);
 /**
  * 关闭多部分消息，生成校验和并释放发送锁。
  *
+ * 启用 TF_USE_SHARED_SENDBUF 时，多部分帧必须在开始它的同一个线程中完成和关闭，
+ * 并且在关闭之前该线程不能用其他实例组合帧。
+ *
  * @param tf - 实例
  */
 void TF_Multipart_Close(TinyFrame *tf);
 
+#if TF_USE_STATS
+
+// ---------------------------------- 统计 ----------------------------------
+
+/**
+ * 实例的统计计数器（32 位，溢出后回绕）。
+ *
+ * 计数器在出错的路径上和每帧一次地递增，不需要启用 TF_Error 的输出即可发现质量变差的链路。
+ * 多个分发通道并行运行时，listener_hits 和 listener_misses 可能少计个别帧。
+ */
+typedef struct TF_Stats_ {
+    /* 接收 */
+    uint32_t rx_frames;           //!< 通过校验并被分发或排队的帧（不含 rx_dropped）
+    uint32_t rx_bytes;            //!< 传给 TF_Accept() / TF_AcceptChar() 的字节
+    uint32_t rx_discarded_bytes;  //!< 不属于有效帧的字节（帧之间的噪声、出错或被丢弃的帧）
+    uint32_t rx_dropped;          //!< 因为没有缓冲区（缓冲池耗尽、接收队列已满）而丢弃的帧
+    uint32_t head_cksum_errors;   //!< 头部校验和不匹配
+    uint32_t body_cksum_errors;   //!< 主体校验和不匹配
+    uint32_t parser_timeouts;     //!< 解析器超时（帧不完整）
+    uint32_t oversize_payloads;   //!< 负载超过 TF_MAX_PAYLOAD_RX 的帧
+
+    /* 分发 */
+    uint32_t listener_hits;       //!< 被监听器处理的帧
+    uint32_t listener_misses;     //!< 没有监听器处理的帧
+    uint32_t rx_queued;           //!< 接收队列中等待分发的帧（所有通道，仅 TF_USE_RX_QUEUE）
+
+    /* 发送 */
+    uint32_t tx_frames;           //!< 发送的帧
+    uint32_t tx_bytes;            //!< 传给 TF_WriteImpl() 的字节
+
+    /* ID 监听器 */
+    uint32_t expired_listeners;     //!< 超时的 ID 监听器
+    uint32_t id_listeners_inflight; //!< 当前的 ID 监听器数量（等待响应的查询）
+    uint32_t id_listeners_peak;     //!< ID 监听器数量的峰值
+} TF_Stats;
+
+/**
+ * 读取统计计数器。可以在任何线程中调用，各个计数器分别读取（不是原子的快照）。
+ *
+ * @param tf - 实例
+ * @param out - 计数器写入这里
+ */
+void TF_GetStats(TinyFrame *tf, TF_Stats *out);
+
+/**
+ * 将计数器清零；id_listeners_peak 重置为当前的 ID 监听器数量。
+ *
+ * @param tf - 实例
+ */
+void TF_ResetStats(TinyFrame *tf);
+
+#endif
+
+
+#if TF_USE_ERROR_CALLBACK
+
+// -------------------------------- 错误报告 --------------------------------
+
+/**
+ * 错误回调。
+ *
+ * 只传递错误码和数字参数，库中不进行任何格式化。每个实例的每个错误码在 TF_ERROR_WINDOW_TICKS
+ * 个 tick 内最多报告 TF_ERROR_BURST 次，其余的只被计数，在该错误码下一次报告时通过 suppressed 传递。
+ *
+ * 回调在出错的线程中调用（通常是解析器），调用时不持有注册表锁，因此可以添加或移除监听器。
+ * 但 TF_ERR_ID_LISTENER_FULL、TF_ERR_SENDBUF_BUSY 等错误在发送过程中报告，此时该实例的发送锁已被持有，
+ * 回调中不能在同一实例上发送（TF_Send、TF_Respond 等），否则会死锁或以 TF_ERR_TX_BUSY 失败。
+ *
+ * @param tf - 实例（与实例无关的错误，例如初始化失败，为 NULL）
+ * @param code - 错误码
+ * @param arg1 - 参数，含义见 TF_ErrorCode
+ * @param arg2 - 参数，含义见 TF_ErrorCode
+ * @param suppressed - 此错误码自上次报告以来被限流丢弃的次数
+ */
+typedef void (*TF_ErrorCallback)(TinyFrame *tf, TF_ErrorCode code, uint32_t arg1, uint32_t arg2, uint32_t suppressed);
+
+/**
+ * 注册错误回调（所有实例共用）。没有注册回调时错误被忽略。
+ *
+ * @param cb - 回调，或 NULL
+ */
+void TF_SetErrorCallback(TF_ErrorCallback cb);
+
+/**
+ * 错误码的名称（例如 "HEAD_CKSUM"），用于日志
+ *
+ * @param code - 错误码
+ * @return 名称，未知的错误码返回 "?"
+ */
+const char *TF_ErrorName(TF_ErrorCode code);
+
+#endif
+
+#if TF_USE_CAPTURE
+
+// ---------------------------------- 抓包 ----------------------------------
+
+/** 抓包记录的方向 */
+typedef enum {
+    TF_CAPTURE_RX = 0,  //!< 接收并通过校验的帧
+    TF_CAPTURE_TX = 1,  //!< 发送的帧
+} TF_CaptureDir;
+
+/** 一帧的抓包记录 */
+typedef struct TF_CaptureRecord_ {
+    uint64_t timestamp;     //!< TF_Timestamp() 的值（帧完成接收，或开始发送时）
+    uint32_t usertag;       //!< 实例的 usertag，用于区分多个实例
+    uint8_t dir;            //!< TF_CaptureDir
+    TF_ID id;
+    TF_TYPE type;
+    TF_LEN len;             //!< 负载的实际长度
+    TF_LEN caplen;          //!< data 中保存的字节数（最多 TF_CAPTURE_SNAPLEN）
+    uint8_t data[TF_CAPTURE_SNAPLEN];
+} TF_CaptureRecord;
+
+/** 抓包环形缓冲区的槽 */
+struct TF_CaptureSlot_ {
+    uint32_t seq;           //!< 槽的序号，表示槽是空闲的还是已填写
+    TF_CaptureRecord rec;
+};
+
+/**
+ * 抓包环形缓冲区（有界，无锁，多生产者单消费者）。
+ *
+ * 任意多个实例的接收和发送路径写入同一个环，一个线程（或进程，如果环位于共享内存中）
+ * 用 TF_CaptureRead() 读出并写入文件。环满时新记录被丢弃并计数，生产者从不等待。
+ */
+typedef struct TF_CaptureRing_ {
+    TF_CACHE_ALIGNED uint32_t head; //!< 生产者的下一个位置
+    TF_CACHE_ALIGNED uint32_t tail; //!< 消费者的下一个位置
+    uint32_t dropped;       //!< 因为环已满而丢弃的记录
+    struct TF_CaptureSlot_ slots[TF_CAPTURE_SLOTS];
+} TF_CaptureRing;
+
+/**
+ * 初始化抓包环形缓冲区（空）
+ *
+ * @param ring - 环
+ */
+void TF_CaptureInit(TF_CaptureRing *ring);
+
+/**
+ * 开始或停止将实例的帧写入抓包环。可以在运行时从任何线程调用。
+ *
+ * 发送的帧在开始时占用一个槽，在结束时提交（多部分帧在关闭之前会阻塞读取后面的记录）。
+ *
+ * @param tf - 实例
+ * @param ring - 环，NULL 表示停止
+ */
+void TF_SetCapture(TinyFrame *tf, TF_CaptureRing *ring);
+
+/**
+ * 读取下一条记录（只能由一个线程调用）
+ *
+ * @param ring - 环
+ * @param out - 记录写入这里
+ * @return 如果读取了一条记录，则返回 true；环为空时返回 false
+ */
+bool TF_CaptureRead(TF_CaptureRing *ring, TF_CaptureRecord *out);
+
+/**
+ * 因为环已满而丢弃的记录数量
+ *
+ * @param ring - 环
+ */
+uint32_t TF_CaptureDropped(TF_CaptureRing *ring);
+
+#endif
+
+#if TF_USE_LATENCY
+
+// ---------------------------------- 查询延迟 ----------------------------------
+
+/**
+ * 一个查询类型的往返延迟摘要，时间单位同 TF_Timestamp()。
+ *
+ * 延迟从 TF_Query() 等函数开始发送（包括在 TF_ClaimTx() 中等待的时间）计到响应的 ID 监听器
+ * 被调用，或者监听器超时。百分位数是直方图桶的上界（相对误差不超过 2^-TF_LATENCY_SUB_BITS）。
+ */
+typedef struct TF_LatencySummary_ {
+    uint32_t count;         //!< 记录的查询数量（包括超时）
+    uint32_t timeouts;      //!< 其中超时的数量（计入超时前等待的时间）
+    uint64_t min;
+    uint64_t max;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+} TF_LatencySummary;
+
+/**
+ * 读取一个查询类型的延迟摘要
+ *
+ * @param tf - 实例
+ * @param type - 查询的类型
+ * @param out - 摘要写入这里
+ * @return 如果该类型有记录，则返回 true
+ */
+bool TF_GetLatency(TinyFrame *tf, TF_TYPE type, TF_LatencySummary *out);
+
+/**
+ * 读取一个查询类型的任意百分位数
+ *
+ * @param tf - 实例
+ * @param type - 查询的类型
+ * @param ppm - 百万分位，例如 999000 表示 p99.9
+ * @return 延迟，没有记录时返回 0
+ */
+uint64_t TF_LatencyPercentile(TinyFrame *tf, TF_TYPE type, uint32_t ppm);
+
+/**
+ * 列出有记录的查询类型
+ *
+ * @param tf - 实例
+ * @param types - 类型写入这里
+ * @param max - types 的容量
+ * @return 写入的类型数量
+ */
+uint32_t TF_LatencyTypes(TinyFrame *tf, TF_TYPE *types, uint32_t max);
+
+/**
+ * 清除所有延迟记录
+ *
+ * @param tf - 实例
+ */
+void TF_ResetLatency(TinyFrame *tf);
+
+#endif
 
 // ---------------------------------- 内部 ----------------------------------
 // 这部分仅公开可见以允许静态初始化。
@@ -409,6 +965,77 @@ enum TF_State_ {
     TFState_DATA_CKSUM    //!< 等待校验和
 };
 
+#if TF_USE_STATS
+
+/** 接收线程（和分发）更新的计数器 */
+struct TF_RxStats_ {
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t rx_discarded_bytes;
+    uint32_t rx_dropped;
+    uint32_t head_cksum_errors;
+    uint32_t body_cksum_errors;
+    uint32_t parser_timeouts;
+    uint32_t oversize_payloads;
+    uint32_t listener_hits;
+    uint32_t listener_misses;
+};
+
+/** 发送锁内更新的计数器 */
+struct TF_TxStats_ {
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+};
+
+/** 注册表锁内更新的计数器 */
+struct TF_RegStats_ {
+    uint32_t expired_listeners;
+    uint32_t id_listeners_inflight;
+    uint32_t id_listeners_peak;
+};
+
+#endif
+
+#if TF_USE_LATENCY
+
+/** 一个查询类型的延迟直方图（对数-线性的桶，类似 HdrHistogram） */
+struct TF_LatencyHist_ {
+    uint32_t buckets[TF_LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t timeouts;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+};
+
+/** 各查询类型的延迟直方图，在注册表锁内更新 */
+struct TF_LatencyTable_ {
+    TF_TYPE types[TF_LATENCY_TYPES];    //!< 每个直方图对应的类型，按首次记录的顺序分配
+    uint32_t count;                     //!< 已分配的直方图数量
+    uint32_t untracked;                 //!< 因为直方图用完而没有记录的查询
+    struct TF_LatencyHist_ hist[TF_LATENCY_TYPES];
+};
+
+#endif
+
+#if TF_USE_ERROR_CALLBACK
+
+/** 一个错误码的限流状态 */
+struct TF_ErrorLimit_ {
+    uint32_t window;        //!< count 所属的时间窗口
+    uint32_t count;         //!< 在此窗口内已报告的次数
+    uint32_t suppressed;    //!< 尚未报告的被丢弃次数
+};
+
+/** 错误限流状态 */
+struct TF_ErrorState_ {
+    uint32_t window;        //!< 当前时间窗口编号（TF_Tick() 递增）
+    uint32_t ticks;         //!< 当前时间窗口内的 tick 数
+    struct TF_ErrorLimit_ limits[TF_ERR__COUNT];
+};
+
+#endif
+
 struct TF_IdListener_ {
     TF_ID id;
     TF_Listener fn;
@@ -417,6 +1044,11 @@ struct TF_IdListener_ {
     TF_TICKS timeout_max; // 原始超时时间存储在这里（0 = 无超时）
     void *userdata;
     void *userdata2;
+#if TF_USE_LATENCY
+    uint64_t sent_at;     // 查询开始发送的时间（TF_Timestamp()）
+    TF_TYPE type;         // 查询的类型
+    bool timed;           // 这是一个查询，延迟尚未记录
+#endif
 };
 
 struct TF_TypeListener_ {
@@ -428,57 +1060,186 @@ struct TF_GenericListener_ {
     TF_Listener fn;
 };
 
-/**
- * 帧解析器内部状态。
- */
-struct TinyFrame_ {
-    /* 公共用户数据 */
-    void *userdata;
-    uint32_t usertag;
+#if TF_USE_RX_QUEUE
 
-    // --- 结构体的其余部分是内部的，请勿直接访问 ---
+/** 接收队列中的一帧 */
+struct TF_RxQueueSlot_ {
+    TF_ID id;
+    TF_TYPE type;
+    TF_LEN len;
+    uint8_t *data;          //!< 租用的负载缓冲区（空帧为 NULL）
+#if TF_USE_RX_TIMESTAMP
+    uint64_t rx_start;
+    uint64_t rx_end;
+#endif
+};
 
-    /* 自身状态 */
-    TF_Peer peer_bit;       //!< 自身的对方位（唯一以避免消息 ID 冲突）
-    TF_ID next_id;          //!< 下一个帧/帧链 ID
+/** 一个分发通道的单生产者单消费者队列 */
+struct TF_RxQueue_ {
+    struct TF_RxQueueSlot_ slots[TF_RX_QUEUE_LEN];
+    uint32_t head;          //!< 解析器的下一个写入位置
+    TF_CACHE_ALIGNED uint32_t tail; //!< 工作线程的下一个读取位置
+    uint8_t *dispatch_data; //!< 正在分发的帧的缓冲区（用于 TF_TakePayload）
+};
 
-    /* 解析器状态 */
+#endif
+
+/**
+ * 解析器（接收）状态。
+ * 只由调用 TF_Accept() 的线程访问（TF_Tick() 只原子地更新超时计数器）。
+ */
+struct TF_RxState_ {
     enum TF_State_ state;
     TF_TICKS parser_timeout_ticks;
     TF_ID id;               //!< 传入数据包 ID
     TF_LEN len;             //!< 负载长度
+#if TF_USE_RX_POOL
+    uint8_t *data;          //!< 从共享池租用的数据缓冲区（没有正在接收的负载时为 NULL）
+#else
     uint8_t data[TF_MAX_PAYLOAD_RX]; //!< 数据字节缓冲区
+#endif
     TF_LEN rxi;             //!< 字段大小字节计数器
     TF_CKSUM cksum;         //!< 从数据流计算的校验和
     TF_CKSUM ref_cksum;     //!< 从消息读取的参考校验和
     TF_TYPE type;           //!< 收集的消息类型编号
     bool discard_data;      //!< 如果 (len > TF_MAX_PAYLOAD) 则设置，以读取帧但忽略数据。
 
-    /* 发送状态 */
+#if TF_USE_RX_TIMESTAMP
+    uint64_t rx_start;      //!< 当前帧的第一个字节被解析的时间
+#endif
+
+#if TF_FULL_DUPLEX
+    uint8_t busy;           //!< 解析器正在运行（用于检测违反并发约定的调用）
+#endif
+
+#if TF_USE_STATS
+    struct TF_RxStats_ stats;
+#endif
+
+#if TF_USE_RX_QUEUE
+    /* 接收队列，每个分发通道一个（解析器写入，工作线程读取） */
+    TF_CACHE_ALIGNED struct TF_RxQueue_ rxq[TF_DISPATCH_LANES];
+#endif
+};
+
+/**
+ * 发送状态。
+ * 只在 TF_ClaimTx() 和 TF_ReleaseTx() 之间访问。
+ */
+struct TF_TxState_ {
+    TF_ID next_id;          //!< 下一个帧/帧链 ID
+
     // 用于构建帧的缓冲区
+#if TF_USE_SHARED_SENDBUF
+    uint8_t *sendbuf;       //!< 组合帧期间借用的线程共享缓冲区（未在发送时为 NULL）
+#else
     uint8_t sendbuf[TF_SENDBUF_LEN]; //!< 发送临时缓冲区
+#endif
 
-    uint32_t tx_pos;        //!< 发送缓冲区中的下一个写入位置（用于多部分）
-    uint32_t tx_len;        //!< 总预期发送长度
-    TF_CKSUM tx_cksum;      //!< 发送校验和累加器
+    uint32_t pos;           //!< 发送缓冲区中的下一个写入位置（用于多部分）
+    uint32_t len;           //!< 总预期发送长度
+    TF_CKSUM cksum;         //!< 发送校验和累加器
 
 #if !TF_USE_MUTEX
     bool soft_lock;         //!< 如果未启用互斥锁功能，则使用的发送锁标志。
 #endif
 
-    /* --- 回调 --- */
+#if TF_USE_CAPTURE
+    struct TF_CaptureSlot_ *cap_slot; //!< 正在发送的帧占用的抓包槽（没有时为 NULL）
+    uint32_t cap_pos;                 //!< 该槽在环中的位置
+#endif
 
-    /* 事务回调 */
-    struct TF_IdListener_ id_listeners[TF_MAX_ID_LST];
+#if TF_USE_STATS
+    struct TF_TxStats_ stats;
+#endif
+};
+
+/** 类型和通用监听器表（一个版本） */
+struct TF_ListenerTable_ {
     struct TF_TypeListener_ type_listeners[TF_MAX_TYPE_LST];
     struct TF_GenericListener_ generic_listeners[TF_MAX_GEN_LST];
 
+    TF_COUNT count_type_lst;
+    TF_COUNT count_generic_lst;
+};
+
+#if TF_USE_LISTENER_TEMPLATE
+
+/** 共享的监听器模板，冻结后不可变 */
+struct TF_ListenerTemplate_ {
+    struct TF_TypeListener_ type_listeners[TF_MAX_TEMPLATE_TYPE_LST]; //!< 冻结后按类型排序
+    struct TF_GenericListener_ generic_listeners[TF_MAX_TEMPLATE_GEN_LST];
+    uint32_t count_type_lst;
+    uint32_t count_generic_lst;
+    bool frozen;
+};
+
+#endif
+
+/**
+ * 监听器注册表。
+ * 启用 TF_USE_REGISTRY_LOCK 时只在 TF_ClaimRegistry() 和 TF_ReleaseRegistry() 之间访问。
+ *
+ * 启用 TF_USE_RCU_LISTENERS 时，类型和通用监听器表有两个版本：读者（分发）不加锁地读取
+ * 已发布的版本，写者（持有注册表锁）修改另一个版本，然后原子地发布它。
+ */
+struct TF_Registry_ {
+    /* 事务回调 */
+    struct TF_IdListener_ id_listeners[TF_MAX_ID_LST];
+
     // 这些计数器用于优化查找时间。
     // 它们指向最高使用的槽编号，
     // 或接近它，取决于移除顺序。
     TF_COUNT count_id_lst;
-    TF_COUNT count_type_lst;
-    TF_COUNT count_generic_lst;
+
+#if TF_USE_LISTENER_TEMPLATE
+    const struct TF_ListenerTemplate_ *tpl; //!< 附加的共享模板（可以为 NULL），初始化后只读
+#endif
+
+#if TF_USE_RCU_LISTENERS
+    struct TF_ListenerTable_ tables[2];
+    uint32_t epoch;         //!< 已发布的版本号，tables[epoch & 1] 是当前表
+    uint32_t readers[2];    //!< 正在读取每个表的读者数量（宽限期在归零时结束）
+#else
+    struct TF_ListenerTable_ tables[1];
+#endif
+
+#if TF_USE_STATS
+    struct TF_RegStats_ stats;
+#endif
+
+#if TF_USE_LATENCY
+    struct TF_LatencyTable_ latency;
+#endif
+};
+
+/**
+ * 帧解析器内部状态。
+ *
+ * 接收、发送和注册表状态分开存放（设置 TF_CACHE_LINE 时各自按缓存行对齐），
+ * 使得接收线程和发送线程在同一个实例上不会伪共享。
+ */
+struct TinyFrame_ {
+    /* 公共用户数据 */
+    void *userdata;
+    uint32_t usertag;
+
+    // --- 结构体的其余部分是内部的，请勿直接访问 ---
+
+    /* 自身状态，初始化后只读 */
+    TF_Peer peer_bit;       //!< 自身的对方位（唯一以避免消息 ID 冲突）
+
+#if TF_USE_CAPTURE
+    TF_CaptureRing *capture; //!< 抓包环（可以为 NULL），由 TF_SetCapture() 原子地设置
+#endif
+
+    TF_CACHE_ALIGNED struct TF_RxState_ rx;   //!< 解析器状态
+    TF_CACHE_ALIGNED struct TF_TxState_ tx;   //!< 发送状态
+    TF_CACHE_ALIGNED struct TF_Registry_ reg; //!< 监听器（回调）
+
+#if TF_USE_ERROR_CALLBACK
+    struct TF_ErrorState_ err; //!< 错误限流
+#endif
 };
 
 
@@ -491,6 +1252,40 @@ struct TinyFrame_ {
  */
 extern void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len);
 
+#if TF_USE_RX_QUEUE
+
+    /**
+     * 解析器已将一帧放入接收队列时调用（在 TF_Accept() 所在的线程中）。
+     * 实现应唤醒负责该通道的线程（例如释放信号量），由其调用 TF_DispatchLane()。
+     */
+    extern void TF_NotifyDispatch(TinyFrame *tf, uint32_t lane);
+
+#endif
+
+#if TF_USE_REGISTRY_LOCK
+
+    /**
+     * 在访问监听器表之前获取注册表锁（阻塞）。
+     * 库在持有此锁时从不调用用户代码（监听器、错误回调、TF_Timestamp()、跟踪点），
+     * 因此可以使用非递归互斥锁，错误回调中也可以添加或移除监听器。
+     */
+    extern void TF_ClaimRegistry(TinyFrame *tf);
+
+    /** 释放注册表锁 */
+    extern void TF_ReleaseRegistry(TinyFrame *tf);
+
+#endif
+
+#if TF_USE_CAPTURE || TF_USE_LATENCY || TF_USE_RX_TIMESTAMP
+
+    /**
+     * 抓包记录、查询延迟和接收时间戳的时钟（单调时钟，单位由应用决定，例如纳秒）。
+     * 每帧调用一次，应当很快（例如读取周期计数器或 CLOCK_MONOTONIC）。
+     */
+    extern uint64_t TF_Timestamp(void);
+
+#endif
+
 // 互斥锁函数
 #if TF_USE_MUTEX
 
@@ -531,4 +1326,8 @@ extern void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len);
 
 #endif
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
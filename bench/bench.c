@@ -0,0 +1,59 @@
+//
+// 基准测试的公共函数
+//
+
+#include <stdlib.h>
+#include <time.h>
+#include "bench.h"
+
+uint64_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+uint64_t bench_budget_ns(void)
+{
+    static uint64_t budget;
+    const char *env;
+
+    if (budget == 0) {
+        env = getenv("TF_BENCH_MS");
+        budget = (env && atoi(env) > 0) ? (uint64_t) atoi(env) * 1000000ull : 200000000ull;
+    }
+    return budget;
+}
+
+uint32_t bench_random(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+void bench_fill(uint8_t *buf, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++) buf[i] = (uint8_t) bench_random();
+}
+
+uint64_t bench_run(bench_fn fn, void *ctx, uint64_t *iters)
+{
+    uint64_t t0, elapsed, n = 0;
+    uint64_t budget = bench_budget_ns();
+
+    fn(ctx);
+
+    t0 = bench_now();
+    do {
+        fn(ctx);
+        n++;
+        elapsed = bench_now() - t0;
+    } while (elapsed < budget);
+
+    *iters = n;
+    return elapsed;
+}
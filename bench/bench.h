@@ -0,0 +1,49 @@
+//
+// 基准测试的公共函数
+//
+// 每个基准在 bench/ 下有自己的目录（与 demo/ 相同，各自有 Makefile 和 TF_Config.h），
+// 计时、时间预算和合成数据由这里的函数提供。这个文件不依赖 TinyFrame.h，
+// 因此可以用于不同配置编译的基准。
+//
+
+#ifndef TF_BENCH_H
+#define TF_BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * 单调时钟（纳秒）
+ */
+uint64_t bench_now(void);
+
+/**
+ * 每个测量点的时间预算（纳秒）。默认 200 ms，可以用环境变量 TF_BENCH_MS 修改，
+ * 例如 TF_BENCH_MS=20 快速检查，TF_BENCH_MS=2000 得到更稳定的结果。
+ */
+uint64_t bench_budget_ns(void);
+
+/**
+ * 固定种子的伪随机数，使每次运行的合成数据相同
+ */
+uint32_t bench_random(void);
+
+/**
+ * 用伪随机字节填充缓冲区
+ */
+void bench_fill(uint8_t *buf, size_t len);
+
+/** 被测量的操作，每次调用应至少需要几微秒，使读取时钟的开销可以忽略 */
+typedef void (*bench_fn)(void *ctx);
+
+/**
+ * 先调用一次 fn 预热，然后重复调用直到用完时间预算
+ *
+ * @param fn - 被测量的操作
+ * @param ctx - 传给 fn 的参数
+ * @param iters - 返回计时的调用次数
+ * @return 计时的调用的总耗时（纳秒）
+ */
+uint64_t bench_run(bench_fn fn, void *ctx, uint64_t *iters);
+
+#endif //TF_BENCH_H
@@ -0,0 +1,33 @@
+//
+// 监听器分发基准的配置
+//
+// 监听器表足够容纳 10000 个监听器，因此 TF_COUNT 为 16 位，ID 和类型也为 16 位。
+// Makefile 另外用 -D 编译一个启用注册表锁和 RCU 监听器表的程序。
+//
+
+#ifndef TF_CONFIG_H
+#define TF_CONFIG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TF_ID_BYTES     2
+#define TF_LEN_BYTES    2
+#define TF_TYPE_BYTES   2
+#define TF_CKSUM_TYPE TF_CKSUM_CRC16
+#define TF_USE_SOF_BYTE 1
+#define TF_SOF_BYTE     0x01
+typedef uint32_t TF_TICKS;
+typedef uint16_t TF_COUNT;
+#define TF_MAX_PAYLOAD_RX 64
+#define TF_SENDBUF_LEN 64
+#define TF_MAX_ID_LST   10000
+#define TF_MAX_TYPE_LST 10000
+#define TF_MAX_GEN_LST  10000
+#define TF_PARSER_TIMEOUT_TICKS 10
+#define TF_USE_STATS 1
+
+// 未处理的帧（miss 场景）每帧报告一次错误，不输出
+#define TF_Error(format, ...) do {} while (0)
+
+#endif //TF_CONFIG_H
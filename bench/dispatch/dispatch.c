@@ -0,0 +1,278 @@
+//
+// 监听器分发基准
+//
+// 注册 N 个 ID、类型或通用监听器（N 从 1 到 10000），测量每帧的分发开销（TF_Accept() 中
+// TF_HandleReceivedMessage() 查找并调用监听器的部分）、TF_Tick() 的开销与存活的 ID 监听器数量的关系，
+// 以及在 N 个监听器存在时添加并移除一个监听器的开销。
+//
+// 分发场景中匹配的监听器总是在表的最后，即线性查找的最坏情况：
+//   id      - N 个 ID 监听器，响应匹配最后一个
+//   type    - N 个类型监听器，帧匹配最后一个
+//   generic - N 个通用监听器，都返回 TF_NEXT（每帧调用 N 次）
+//   miss    - N 个类型监听器，没有匹配的（未处理的帧）
+// "分发"列减去了只有一个类型监听器时的开销（解析帧的开销）。
+//
+//   dispatch*.bin [N...]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../TinyFrame.h"
+#include "bench.h"
+
+#if TF_USE_REGISTRY_LOCK
+#include <pthread.h>
+#endif
+
+#if TF_USE_RCU_LISTENERS
+    #define CONFIG_NAME "注册表锁，RCU 监听器表"
+#elif TF_USE_REGISTRY_LOCK
+    #define CONFIG_NAME "注册表锁"
+#else
+    #define CONFIG_NAME "无锁"
+#endif
+
+/** 每段流中的帧数 */
+#define STREAM_FRAMES 1024
+/** 每次计时调用中 TF_Tick() 或添加/移除的次数 */
+#define OPS_PER_CALL 64
+/** ID 监听器的超时足够长，测量期间不会过期 */
+#define LONG_TIMEOUT 0xFFFFFFF0u
+
+static const uint32_t default_counts[] = {1, 10, 100, 1000, 10000};
+
+static TinyFrame tx_tf, rx_tf;
+static uint8_t stream[STREAM_FRAMES * 16];
+static uint32_t stream_len;
+static uint64_t listener_calls;
+static double baseline_ns;
+
+#if TF_USE_REGISTRY_LOCK
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void TF_ClaimRegistry(TinyFrame *tf)
+{
+    (void) tf;
+    pthread_mutex_lock(&registry_mutex);
+}
+
+void TF_ReleaseRegistry(TinyFrame *tf)
+{
+    (void) tf;
+    pthread_mutex_unlock(&registry_mutex);
+}
+#endif
+
+/** 发送方的输出组成流 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    (void) tf;
+    memcpy(stream + stream_len, buff, len);
+    stream_len += len;
+}
+
+static TF_Result stayListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    listener_calls++;
+    return TF_STAY;
+}
+
+static TF_Result nextListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    listener_calls++;
+    return TF_NEXT;
+}
+
+/** 生成 STREAM_FRAMES 个空帧。response 为 true 时帧是对 ID id 的响应 */
+static void make_stream(TF_TYPE type, bool response, TF_ID id)
+{
+    TF_Msg msg;
+    uint32_t i;
+
+    stream_len = 0;
+    for (i = 0; i < STREAM_FRAMES; i++) {
+        TF_ClearMsg(&msg);
+        msg.type = type;
+        if (response) {
+            msg.frame_id = id;
+            TF_Respond(&tx_tf, &msg);
+        } else {
+            TF_Send(&tx_tf, &msg);
+        }
+    }
+}
+
+/** 注册 n 个 ID 监听器，ID 为 first 到 first + n - 1 */
+static void add_id_listeners(uint32_t first, uint32_t n, TF_TICKS timeout)
+{
+    TF_Msg msg;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        TF_ClearMsg(&msg);
+        msg.frame_id = (TF_ID) (first + i);
+        TF_AddIdListener(&rx_tf, &msg, stayListener, NULL, timeout);
+    }
+}
+
+static void add_type_listeners(uint32_t n)
+{
+    uint32_t i;
+    for (i = 0; i < n; i++) TF_AddTypeListener(&rx_tf, (TF_TYPE) i, stayListener);
+}
+
+static void add_generic_listeners(uint32_t n)
+{
+    uint32_t i;
+    for (i = 0; i < n; i++) TF_AddGenericListener(&rx_tf, nextListener);
+}
+
+//region 测量的操作
+
+static void feed(void *ctx)
+{
+    (void) ctx;
+    TF_Accept(&rx_tf, stream, stream_len);
+}
+
+static void tick(void *ctx)
+{
+    uint32_t i;
+    (void) ctx;
+    for (i = 0; i < OPS_PER_CALL; i++) TF_Tick(&rx_tf);
+}
+
+static void churn_id(void *ctx)
+{
+    TF_ID id = (TF_ID) *(uint32_t *) ctx;
+    TF_Msg msg;
+    uint32_t i;
+
+    TF_ClearMsg(&msg);
+    msg.frame_id = id;
+    for (i = 0; i < OPS_PER_CALL; i++) {
+        TF_AddIdListener(&rx_tf, &msg, stayListener, NULL, LONG_TIMEOUT);
+        TF_RemoveIdListener(&rx_tf, id);
+    }
+}
+
+static void churn_type(void *ctx)
+{
+    TF_TYPE type = (TF_TYPE) *(uint32_t *) ctx;
+    uint32_t i;
+
+    for (i = 0; i < OPS_PER_CALL; i++) {
+        TF_AddTypeListener(&rx_tf, type, stayListener);
+        TF_RemoveTypeListener(&rx_tf, type);
+    }
+}
+
+//endregion 测量的操作
+
+/** 测量分发，并检查监听器被调用的次数（每帧 calls_per_frame 次） */
+static bool measure_dispatch(const char *name, uint32_t n, uint32_t calls_per_frame)
+{
+    uint64_t iters, ns, expected;
+    double per_frame;
+
+    listener_calls = 0;
+    ns = bench_run(feed, NULL, &iters);
+    per_frame = (double) ns / ((double) iters * STREAM_FRAMES);
+    expected = (iters + 1) * STREAM_FRAMES * calls_per_frame;
+
+    printf("%6u  %-8s %12.1f %12.1f\n", n, name, per_frame, per_frame - baseline_ns);
+
+    if (listener_calls != expected) {
+        fprintf(stderr, "错误：监听器被调用 %llu 次，应为 %llu\n",
+                (unsigned long long) listener_calls, (unsigned long long) expected);
+        return false;
+    }
+    return true;
+}
+
+static void measure_op(const char *name, uint32_t n, bench_fn fn, void *ctx)
+{
+    uint64_t iters, ns;
+
+    ns = bench_run(fn, ctx, &iters);
+    printf("%6u  %-8s %12.1f %12s\n", n, name, (double) ns / ((double) iters * OPS_PER_CALL), "-");
+}
+
+static void reset(void)
+{
+    TF_InitStatic(&rx_tf, TF_SLAVE);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t counts[32];
+    uint32_t ncounts = 0, i, n, last;
+    uint64_t iters, ns;
+    double per_frame;
+
+    if (argc > 1) {
+        for (i = 1; i < (uint32_t) argc && ncounts < 32; i++) counts[ncounts++] = (uint32_t) strtoul(argv[i], NULL, 0);
+    }
+    else {
+        for (i = 0; i < sizeof(default_counts) / sizeof(default_counts[0]); i++) counts[ncounts++] = default_counts[i];
+    }
+
+    TF_InitStatic(&tx_tf, TF_MASTER);
+
+    // 基线：一个匹配的类型监听器。取三次中最快的一次，排除刚开始运行时 CPU 频率的变化
+    reset();
+    add_type_listeners(1);
+    make_stream(0, false, 0);
+    for (i = 0; i < 3; i++) {
+        ns = bench_run(feed, NULL, &iters);
+        per_frame = (double) ns / ((double) iters * STREAM_FRAMES);
+        if (i == 0 || per_frame < baseline_ns) baseline_ns = per_frame;
+    }
+
+    printf("%s，基线（解析一帧）%.1f ns\n", CONFIG_NAME, baseline_ns);
+    printf("%6s  %-8s %12s %12s\n", "N", "场景", "ns/帧或次", "分发 ns");
+
+    for (i = 0; i < ncounts; i++) {
+        n = counts[i];
+        if (n == 0 || n > TF_MAX_ID_LST || n > TF_MAX_TYPE_LST || n > TF_MAX_GEN_LST) continue;
+        last = n - 1;
+
+        reset();
+        add_id_listeners(0, n, 0);
+        make_stream(0, true, (TF_ID) last);
+        if (!measure_dispatch("id", n, 1)) return 1;
+
+        reset();
+        add_type_listeners(n);
+        make_stream((TF_TYPE) last, false, 0);
+        if (!measure_dispatch("type", n, 1)) return 1;
+
+        make_stream((TF_TYPE) n, false, 0);
+        if (!measure_dispatch("miss", n, 0)) return 1;
+
+        reset();
+        add_generic_listeners(n);
+        make_stream(0, false, 0);
+        if (!measure_dispatch("generic", n, n)) return 1;
+
+        // 每次 TF_Tick() 递减所有 ID 监听器的超时
+        reset();
+        add_id_listeners(0, n, LONG_TIMEOUT);
+        measure_op("tick", n, tick, NULL);
+
+        // 添加并移除第 N 个监听器
+        reset();
+        add_id_listeners(0, last, LONG_TIMEOUT);
+        measure_op("churn-id", n, churn_id, &last);
+
+        reset();
+        add_type_listeners(last);
+        measure_op("churn-ty", n, churn_type, &last);
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+//
+// 端到端回环基准
+//
+// 主站和从站实例分别在两个线程中运行，通过 socketpair、一对管道或一对伪终端连接，
+// 测量包括 TF_WriteImpl()、系统调用和线程唤醒在内的整个栈：
+//   往返 - 主站用 TF_Query() 发送，从站用 TF_Respond() 回显，逐个测量往返时间（p50 到 p99.9）
+//   批量 - 主站连续发送帧，最后一个查询的响应带回从站收到的帧数，测量持续的吞吐量
+//
+//   loopback.bin [-s 往返负载] [socketpair|pipe|pty ...]
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include "../../TinyFrame.h"
+#include "bench.h"
+
+#define TYPE_PING 1     //!< 从站回显
+#define TYPE_BULK 2     //!< 从站计数
+#define TYPE_END  3     //!< 从站以收到的批量帧数和字节数响应
+
+/** 最多记录的往返时间 */
+#define MAX_SAMPLES (1u << 20)
+
+static const uint32_t bulk_sizes[] = {16, 256, 1024, 4096};
+
+/** 一个实例的连接：读取和写入的文件描述符（socketpair 和伪终端两者相同） */
+struct endpoint {
+    int rfd;
+    int wfd;
+};
+
+static TinyFrame master_tf, slave_tf;
+static struct endpoint master_ep, slave_ep;
+static uint8_t payload[4096];
+static uint64_t rtts[MAX_SAMPLES];
+
+// 只由从站线程访问
+static uint32_t slave_frames;
+static uint64_t slave_bytes;
+
+// 只由主站线程访问
+static bool got_response;
+static uint8_t response[16];
+
+/** 写入实例的连接，处理部分写入 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    struct endpoint *ep = tf->userdata;
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(ep->wfd, buff, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            exit(1);
+        }
+        buff += n;
+        len -= (uint32_t) n;
+    }
+}
+
+//region 从站
+
+static TF_Result pingListener(TinyFrame *tf, TF_Msg *msg)
+{
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+static TF_Result bulkListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    slave_frames++;
+    slave_bytes += msg->len;
+    return TF_STAY;
+}
+
+static TF_Result endListener(TinyFrame *tf, TF_Msg *msg)
+{
+    uint8_t buf[12];
+
+    memcpy(buf, &slave_frames, 4);
+    memcpy(buf + 4, &slave_bytes, 8);
+    slave_frames = 0;
+    slave_bytes = 0;
+
+    msg->data = buf;
+    msg->len = sizeof(buf);
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+/** 从站线程：接收直到连接关闭 */
+static void *slave_thread(void *unused)
+{
+    uint8_t buf[4096];
+    ssize_t n;
+    (void) unused;
+
+    for (;;) {
+        n = read(slave_ep.rfd, buf, sizeof(buf));
+        if (n > 0) {
+            TF_Accept(&slave_tf, buf, (uint32_t) n);
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            break; // 主站关闭了连接（伪终端返回 EIO）
+        }
+    }
+    return NULL;
+}
+
+//endregion 从站
+
+//region 主站
+
+static TF_Result responseListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    memcpy(response, msg->data, msg->len < sizeof(response) ? msg->len : sizeof(response));
+    got_response = true;
+    return TF_CLOSE;
+}
+
+/** 发送查询并接收直到响应到达 */
+static bool query(TF_TYPE type, const uint8_t *data, TF_LEN len)
+{
+    uint8_t buf[4096];
+    TF_Msg msg;
+    ssize_t n;
+
+    TF_ClearMsg(&msg);
+    msg.type = type;
+    msg.data = data;
+    msg.len = len;
+    got_response = false;
+    if (!TF_Query(&master_tf, &msg, responseListener, NULL, 0)) return false;
+
+    while (!got_response) {
+        n = read(master_ep.rfd, buf, sizeof(buf));
+        if (n > 0) {
+            TF_Accept(&master_tf, buf, (uint32_t) n);
+        }
+        else if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            perror("read");
+            return false;
+        }
+    }
+    return true;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static bool run_pingpong(TF_LEN size)
+{
+    uint64_t t0, start, budget = bench_budget_ns();
+    uint32_t n = 0;
+
+    // 预热：唤醒从站线程，填充缓存
+    if (!query(TYPE_PING, payload, size)) return false;
+
+    start = bench_now();
+    do {
+        t0 = bench_now();
+        if (!query(TYPE_PING, payload, size)) return false;
+        rtts[n++] = bench_now() - t0;
+    } while (n < MAX_SAMPLES && bench_now() - start < budget);
+
+    qsort(rtts, n, sizeof(uint64_t), cmp_u64);
+    printf("  往返 %u 字节 x %u：p50 %.1f us，p90 %.1f us，p99 %.1f us，p99.9 %.1f us，最大 %.1f us\n",
+           size, n, rtts[n / 2] / 1e3, rtts[(uint64_t) n * 90 / 100] / 1e3, rtts[(uint64_t) n * 99 / 100] / 1e3,
+           rtts[(uint64_t) n * 999 / 1000] / 1e3, rtts[n - 1] / 1e3);
+    return true;
+}
+
+static bool run_bulk(TF_LEN size)
+{
+    uint64_t start, elapsed, budget = bench_budget_ns();
+    uint32_t sent = 0, received, i;
+    uint64_t bytes;
+    TF_Msg msg;
+
+    start = bench_now();
+    do {
+        // 每批 64 帧检查一次时间
+        for (i = 0; i < 64; i++) {
+            TF_ClearMsg(&msg);
+            msg.type = TYPE_BULK;
+            msg.data = payload;
+            msg.len = size;
+            TF_Send(&master_tf, &msg);
+        }
+        sent += 64;
+    } while (bench_now() - start < budget);
+
+    // 帧按顺序到达，因此结束查询的响应表示之前的帧都已处理
+    if (!query(TYPE_END, NULL, 0)) return false;
+    elapsed = bench_now() - start;
+
+    memcpy(&received, response, 4);
+    memcpy(&bytes, response + 4, 8);
+    printf("  批量 %4u 字节：%10.0f 帧/s，%8.1f MB/s\n",
+           size, received / (elapsed / 1e9), bytes / (elapsed / 1e9) / 1e6);
+
+    if (received != sent) {
+        fprintf(stderr, "错误：发送 %u 帧，从站收到 %u 帧\n", sent, received);
+        return false;
+    }
+    return true;
+}
+
+//endregion 主站
+
+//region 连接
+
+/** 打开一对伪终端，两端都设置为原始模式（不回显，不转换字节） */
+static bool open_pty(int *mfd, int *sfd)
+{
+    struct termios tio;
+
+    *mfd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*mfd < 0 || grantpt(*mfd) != 0 || unlockpt(*mfd) != 0) return false;
+    *sfd = open(ptsname(*mfd), O_RDWR | O_NOCTTY);
+    if (*sfd < 0) return false;
+
+    if (tcgetattr(*sfd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    if (tcsetattr(*sfd, TCSANOW, &tio) != 0) return false;
+    if (tcgetattr(*mfd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    return tcsetattr(*mfd, TCSANOW, &tio) == 0;
+}
+
+/** 建立连接，返回要在结束时关闭的文件描述符 */
+static bool connect_transport(const char *name, int fds[4], uint32_t *nfds)
+{
+    int sv[2], p1[2], p2[2];
+
+    if (strcmp(name, "socketpair") == 0) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) return false;
+        master_ep.rfd = master_ep.wfd = sv[0];
+        slave_ep.rfd = slave_ep.wfd = sv[1];
+        fds[0] = sv[0];
+        fds[1] = sv[1];
+        *nfds = 2;
+        return true;
+    }
+    if (strcmp(name, "pipe") == 0) {
+        if (pipe(p1) != 0 || pipe(p2) != 0) return false;
+        master_ep.wfd = p1[1];
+        slave_ep.rfd = p1[0];
+        slave_ep.wfd = p2[1];
+        master_ep.rfd = p2[0];
+        fds[0] = p1[1];
+        fds[1] = p1[0];
+        fds[2] = p2[1];
+        fds[3] = p2[0];
+        *nfds = 4;
+        return true;
+    }
+    if (strcmp(name, "pty") == 0) {
+        if (!open_pty(&sv[0], &sv[1])) return false;
+        master_ep.rfd = master_ep.wfd = sv[0];
+        slave_ep.rfd = slave_ep.wfd = sv[1];
+        fds[0] = sv[0];
+        fds[1] = sv[1];
+        *nfds = 2;
+        return true;
+    }
+    errno = EINVAL;
+    return false;
+}
+
+//endregion 连接
+
+static bool run_transport(const char *name, TF_LEN ping_size)
+{
+    pthread_t thread;
+    int fds[4];
+    uint32_t nfds, i;
+    bool ok = true;
+
+    if (!connect_transport(name, fds, &nfds)) {
+        perror(name);
+        return false;
+    }
+
+    TF_InitStatic(&master_tf, TF_MASTER);
+    TF_InitStatic(&slave_tf, TF_SLAVE);
+    master_tf.userdata = &master_ep;
+    slave_tf.userdata = &slave_ep;
+    TF_AddTypeListener(&slave_tf, TYPE_PING, pingListener);
+    TF_AddTypeListener(&slave_tf, TYPE_BULK, bulkListener);
+    TF_AddTypeListener(&slave_tf, TYPE_END, endListener);
+
+    pthread_create(&thread, NULL, slave_thread, NULL);
+
+    printf("%s：\n", name);
+    ok = run_pingpong(ping_size);
+    for (i = 0; ok && i < sizeof(bulk_sizes) / sizeof(bulk_sizes[0]); i++) {
+        ok = run_bulk((TF_LEN) bulk_sizes[i]);
+    }
+
+    // 关闭主站一端，从站线程读到结束后退出
+    close(master_ep.wfd);
+    if (master_ep.rfd != master_ep.wfd) close(master_ep.rfd);
+    pthread_join(thread, NULL);
+    for (i = 0; i < nfds; i++) {
+        if (fds[i] != master_ep.rfd && fds[i] != master_ep.wfd) close(fds[i]);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *all[] = {"socketpair", "pipe", "pty"};
+    TF_LEN ping_size = 16;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt) {
+            case 's': ping_size = (TF_LEN) strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "用法: loopback.bin [-s 往返负载] [socketpair|pipe|pty ...]\n");
+                return 2;
+        }
+    }
+    if (ping_size > sizeof(payload)) ping_size = sizeof(payload);
+    bench_fill(payload, sizeof(payload));
+
+    printf("TF_SENDBUF_LEN %d\n", TF_SENDBUF_LEN);
+    if (optind < argc) {
+        for (i = optind; i < argc; i++) {
+            if (!run_transport(argv[i], ping_size)) return 1;
+        }
+    }
+    else {
+        for (i = 0; i < 3; i++) {
+            if (!run_transport(all[i], ping_size)) return 1;
+        }
+    }
+    return 0;
+}
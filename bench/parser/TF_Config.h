@@ -0,0 +1,39 @@
+//
+// 解析器基准的配置
+//
+// 帧格式由 Makefile 用 -D 覆盖，为每种校验和类型和字段宽度编译一个程序。
+//
+
+#ifndef TF_CONFIG_H
+#define TF_CONFIG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TF_ID_BYTES
+#define TF_ID_BYTES     1
+#endif
+#ifndef TF_LEN_BYTES
+#define TF_LEN_BYTES    2
+#endif
+#ifndef TF_TYPE_BYTES
+#define TF_TYPE_BYTES   1
+#endif
+#ifndef TF_CKSUM_TYPE
+#define TF_CKSUM_TYPE TF_CKSUM_CRC16
+#endif
+#define TF_USE_SOF_BYTE 1
+#define TF_SOF_BYTE     0x01
+typedef uint16_t TF_TICKS;
+typedef uint8_t TF_COUNT;
+#define TF_MAX_PAYLOAD_RX 65535
+#define TF_SENDBUF_LEN 1024
+#define TF_MAX_ID_LST   10
+#define TF_MAX_TYPE_LST 10
+#define TF_MAX_GEN_LST  5
+#define TF_PARSER_TIMEOUT_TICKS 10
+#define TF_USE_STATS 1
+
+#define TF_Error(format, ...) printf("[TF] " format "\n", ##__VA_ARGS__)
+
+#endif //TF_CONFIG_H
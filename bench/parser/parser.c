@@ -0,0 +1,199 @@
+//
+// 解析器吞吐量基准
+//
+// 为每个负载大小生成一段合成的帧流，测量 TF_Accept() 的吞吐量（MB/s、ns/字节、帧/s），
+// 分别整块传入（一次调用传入整段流）和逐字节传入（每个字节调用一次 TF_AcceptChar()，
+// 相当于在 UART 中断中接收）。帧格式在编译时确定，Makefile 为每种校验和类型和字段宽度
+// 编译一个程序。
+//
+//   parser_*.bin [负载大小...]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../TinyFrame.h"
+#include "bench.h"
+
+#if TF_CKSUM_TYPE == TF_CKSUM_NONE
+    #define CKSUM_NAME "NONE"
+#elif TF_CKSUM_TYPE == TF_CKSUM_XOR
+    #define CKSUM_NAME "XOR"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC8
+    #define CKSUM_NAME "CRC8"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC16
+    #define CKSUM_NAME "CRC16"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC32
+    #define CKSUM_NAME "CRC32"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CUSTOM8
+    #define CKSUM_NAME "CUSTOM8"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CUSTOM16
+    #define CKSUM_NAME "CUSTOM16"
+#elif TF_CKSUM_TYPE == TF_CKSUM_CUSTOM32
+    #define CKSUM_NAME "CUSTOM32"
+#endif
+
+/** LEN 字段能表示的最大负载 */
+#if TF_LEN_BYTES == 1
+    #define MAX_LEN 255u
+#else
+    #define MAX_LEN 65535u
+#endif
+
+/** 每段流的目标大小，短帧的流包含更多帧 */
+#define STREAM_TARGET (256u * 1024u)
+
+static const uint32_t default_sizes[] = {0, 1, 16, 64, 256, 1024, 4096, 16384, 65535};
+
+static TinyFrame tx_tf, rx_tf;
+static uint8_t *stream;
+static uint32_t stream_len, stream_cap;
+static uint64_t frames_dispatched;
+
+//region 自定义校验和
+
+#if TF_CKSUM_TYPE == TF_CKSUM_CUSTOM8
+// 字节和
+TF_CKSUM TF_CksumStart(void) { return 0; }
+TF_CKSUM TF_CksumAdd(TF_CKSUM cksum, uint8_t byte) { return (TF_CKSUM) (cksum + byte); }
+TF_CKSUM TF_CksumEnd(TF_CKSUM cksum) { return (TF_CKSUM) ~cksum; }
+#elif TF_CKSUM_TYPE == TF_CKSUM_CUSTOM16
+// Fletcher-16
+TF_CKSUM TF_CksumStart(void) { return 0; }
+TF_CKSUM TF_CksumAdd(TF_CKSUM cksum, uint8_t byte)
+{
+    uint16_t s1 = (uint16_t) ((cksum & 0xFF) + byte) % 255;
+    uint16_t s2 = (uint16_t) ((cksum >> 8) + s1) % 255;
+    return (TF_CKSUM) ((s2 << 8) | s1);
+}
+TF_CKSUM TF_CksumEnd(TF_CKSUM cksum) { return cksum; }
+#elif TF_CKSUM_TYPE == TF_CKSUM_CUSTOM32
+// 按字节的 Fletcher-32
+TF_CKSUM TF_CksumStart(void) { return 0; }
+TF_CKSUM TF_CksumAdd(TF_CKSUM cksum, uint8_t byte)
+{
+    uint32_t s1 = ((cksum & 0xFFFF) + byte) % 65535;
+    uint32_t s2 = ((cksum >> 16) + s1) % 65535;
+    return (s2 << 16) | s1;
+}
+TF_CKSUM TF_CksumEnd(TF_CKSUM cksum) { return cksum; }
+#endif
+
+//endregion 自定义校验和
+
+/** 发送方的输出追加到流中 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    (void) tf;
+    if (stream_len + len > stream_cap) {
+        stream_cap = (stream_len + len) * 2;
+        stream = realloc(stream, stream_cap);
+        if (!stream) {
+            fprintf(stderr, "内存不足\n");
+            exit(1);
+        }
+    }
+    memcpy(stream + stream_len, buff, len);
+    stream_len += len;
+}
+
+static TF_Result countListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    frames_dispatched++;
+    return TF_STAY;
+}
+
+/** 生成包含 frames 个负载为 size 字节的帧的流 */
+static void make_stream(uint32_t size, uint32_t frames)
+{
+    static uint8_t payload[MAX_LEN];
+    TF_Msg msg;
+    uint32_t i;
+
+    stream_len = 0;
+    for (i = 0; i < frames; i++) {
+        bench_fill(payload, size);
+        TF_ClearMsg(&msg);
+        msg.type = (TF_TYPE) (i % 8);
+        msg.data = payload;
+        msg.len = (TF_LEN) size;
+        TF_Send(&tx_tf, &msg);
+    }
+}
+
+static void feed_whole(void *ctx)
+{
+    (void) ctx;
+    TF_Accept(&rx_tf, stream, stream_len);
+}
+
+static void feed_dribble(void *ctx)
+{
+    uint32_t i;
+    (void) ctx;
+    for (i = 0; i < stream_len; i++) TF_AcceptChar(&rx_tf, stream[i]);
+}
+
+/** 测量一种传入方式，并检查每一帧都被分发 */
+static bool measure(const char *mode, bench_fn fn, uint32_t size, uint32_t frames)
+{
+    TF_Stats st;
+    uint64_t iters, ns, expected;
+
+    frames_dispatched = 0;
+    ns = bench_run(fn, NULL, &iters);
+    expected = (iters + 1) * frames;
+
+    printf("%8u  %-8s %10.1f %10.3f %12.0f\n", size, mode,
+           (double) stream_len * iters / (ns / 1e9) / 1e6,
+           (double) ns / ((double) stream_len * iters),
+           (double) frames * iters / (ns / 1e9));
+
+    TF_GetStats(&rx_tf, &st);
+    if (frames_dispatched != expected || st.head_cksum_errors || st.body_cksum_errors) {
+        fprintf(stderr, "错误：分发 %llu 帧，应为 %llu（帧头校验错误 %u，负载校验错误 %u）\n",
+                (unsigned long long) frames_dispatched, (unsigned long long) expected,
+                st.head_cksum_errors, st.body_cksum_errors);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sizes[32];
+    uint32_t nsizes = 0, i, size, frames;
+
+    if (argc > 1) {
+        for (i = 1; i < (uint32_t) argc && nsizes < 32; i++) sizes[nsizes++] = (uint32_t) strtoul(argv[i], NULL, 0);
+    }
+    else {
+        for (i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) sizes[nsizes++] = default_sizes[i];
+    }
+
+    TF_InitStatic(&tx_tf, TF_MASTER);
+    TF_InitStatic(&rx_tf, TF_SLAVE);
+    TF_AddGenericListener(&rx_tf, countListener);
+
+    printf("校验和 %s，ID/LEN/TYPE %d/%d/%d 字节，SOF %d\n",
+           CKSUM_NAME, TF_ID_BYTES, TF_LEN_BYTES, TF_TYPE_BYTES, TF_USE_SOF_BYTE);
+    printf("%8s  %-8s %10s %10s %12s\n", "负载", "方式", "MB/s", "ns/字节", "帧/s");
+
+    for (i = 0; i < nsizes; i++) {
+        size = sizes[i];
+        if (size > MAX_LEN || size > TF_MAX_PAYLOAD_RX) continue;
+
+        // 开销（帧头和校验和）也算在吞吐量中
+        frames = STREAM_TARGET / (size + 16);
+        if (frames == 0) frames = 1;
+        make_stream(size, frames);
+
+        if (!measure("整块", feed_whole, size, frames)) return 1;
+        if (!measure("逐字节", feed_dribble, size, frames)) return 1;
+    }
+
+    free(stream);
+    return 0;
+}
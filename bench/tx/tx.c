@@ -0,0 +1,151 @@
+//
+// 发送基准
+//
+// 测量 TF_Send()、TF_Query() 和多部分发送（TF_Send_Multipart() + TF_Multipart_Payload() +
+// TF_Multipart_Close()）组合帧的速度（帧/s、负载 MB/s），并统计每帧调用 TF_WriteImpl() 的次数。
+// TF_WriteImpl() 只计数，因此结果是库本身的开销；实际的写入（系统调用、DMA）越贵，
+// 每帧的写入次数越重要。Makefile 为每个 TF_SENDBUF_LEN 编译一个程序，用于比较发送缓冲区
+// 占用的内存和它引起的写入次数。
+//
+//   tx_*.bin [负载大小...]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../TinyFrame.h"
+#include "bench.h"
+
+/** 多部分发送时每次 TF_Multipart_Payload() 传入的字节数（模拟逐段生成负载的应用） */
+#define MULTIPART_PIECE 64
+
+/** 每次计时调用发送的负载总量，短帧的批次包含更多帧 */
+#define BATCH_TARGET (64u * 1024u)
+
+static const uint32_t default_sizes[] = {0, 16, 64, 256, 1024, 4096, 16384, 65535};
+
+static TinyFrame tf;
+static uint8_t payload[65535];
+static uint64_t write_calls, write_bytes;
+
+/** 帧的去向：只计数 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    (void) tf;
+    (void) buff;
+    write_calls++;
+    write_bytes += len;
+}
+
+static TF_Result queryListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    return TF_CLOSE;
+}
+
+/** 一次计时调用的参数 */
+struct batch {
+    uint32_t size;
+    uint32_t frames;
+};
+
+static void send_batch(void *ctx)
+{
+    struct batch *b = ctx;
+    TF_Msg msg;
+    uint32_t i;
+
+    for (i = 0; i < b->frames; i++) {
+        TF_ClearMsg(&msg);
+        msg.type = 1;
+        msg.data = payload;
+        msg.len = (TF_LEN) b->size;
+        TF_Send(&tf, &msg);
+    }
+}
+
+/** 查询，随后移除 ID 监听器（相当于响应到达），使监听器表不会填满 */
+static void query_batch(void *ctx)
+{
+    struct batch *b = ctx;
+    TF_Msg msg;
+    uint32_t i;
+
+    for (i = 0; i < b->frames; i++) {
+        TF_ClearMsg(&msg);
+        msg.type = 1;
+        msg.data = payload;
+        msg.len = (TF_LEN) b->size;
+        TF_Query(&tf, &msg, queryListener, NULL, 100);
+        TF_RemoveIdListener(&tf, msg.frame_id);
+    }
+}
+
+static void multipart_batch(void *ctx)
+{
+    struct batch *b = ctx;
+    TF_Msg msg;
+    uint32_t i, pos, n;
+
+    for (i = 0; i < b->frames; i++) {
+        TF_ClearMsg(&msg);
+        msg.type = 1;
+        msg.len = (TF_LEN) b->size;
+        TF_Send_Multipart(&tf, &msg);
+        for (pos = 0; pos < b->size; pos += n) {
+            n = b->size - pos < MULTIPART_PIECE ? b->size - pos : MULTIPART_PIECE;
+            TF_Multipart_Payload(&tf, payload + pos, n);
+        }
+        TF_Multipart_Close(&tf);
+    }
+}
+
+static void measure(const char *path, bench_fn fn, uint32_t size)
+{
+    struct batch b;
+    uint64_t iters, ns, frames;
+
+    b.size = size;
+    b.frames = BATCH_TARGET / (size + 16);
+    if (b.frames == 0) b.frames = 1;
+
+    write_calls = 0;
+    write_bytes = 0;
+    ns = bench_run(fn, &b, &iters);
+
+    // 预热调用也被计入 write_calls
+    frames = (iters + 1) * b.frames;
+    printf("%8u  %-6s %12.0f %10.1f %10.2f %10.1f\n", size, path,
+           (double) b.frames * iters / (ns / 1e9),
+           (double) size * b.frames * iters / (ns / 1e9) / 1e6,
+           (double) write_calls / frames,
+           (double) write_bytes / write_calls);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sizes[32];
+    uint32_t nsizes = 0, i;
+
+    if (argc > 1) {
+        for (i = 1; i < (uint32_t) argc && nsizes < 32; i++) sizes[nsizes++] = (uint32_t) strtoul(argv[i], NULL, 0);
+    }
+    else {
+        for (i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) sizes[nsizes++] = default_sizes[i];
+    }
+
+    TF_InitStatic(&tf, TF_MASTER);
+    bench_fill(payload, sizeof(payload));
+
+    printf("TF_SENDBUF_LEN %d，sizeof(TinyFrame) %u 字节\n", TF_SENDBUF_LEN, (unsigned) sizeof(TinyFrame));
+    printf("%8s  %-6s %12s %10s %10s %10s\n", "负载", "方式", "帧/s", "MB/s", "写入/帧", "字节/写入");
+
+    for (i = 0; i < nsizes; i++) {
+        if (sizes[i] > sizeof(payload)) continue;
+        measure("send", send_batch, sizes[i]);
+        measure("query", query_batch, sizes[i]);
+        // 长度为 0 的帧在 TF_Send_Multipart() 中就已经发送完成，不能再调用 TF_Multipart_Close()
+        if (sizes[i] > 0) measure("multi", multipart_batch, sizes[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,228 @@
+//
+// C++20 协程查询演示（utilities/tf_coro.hpp）
+//
+// 同一个协程（两个回显查询和一个不会得到响应的查询）在三种链路上运行：
+//   同步   - 写出的字节立即交给对方，响应在 TF_Query() 返回之前到达，协程不挂起
+//   事件循环 - 写出的字节先排队，由主循环交给对方，协程在 TF_Accept() 中恢复
+//   接收线程 - 通过管道连接，主站的 TF_Accept() 在接收线程中调用，协程在那里恢复
+// 不会得到响应的查询在 TF_Tick() 中超时（接收线程的场景中主循环每毫秒调用一次 TF_Tick()）。
+//
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <unistd.h>
+#include <pthread.h>
+#include "../../TinyFrame.h"
+#include "tf_coro.hpp"
+
+#define TYPE_ECHO   1   //!< 从站把负载原样响应
+#define TYPE_SILENT 2   //!< 从站不响应
+
+enum class Link {
+    Sync,
+    Queued,
+    Thread,
+};
+
+/** 每个实例的锁 */
+struct link {
+    pthread_mutex_t tx_mutex;
+    pthread_mutex_t reg_mutex;
+};
+
+static TinyFrame master, slave;
+static struct link link_master, link_slave;
+static Link mode;
+
+static std::vector<uint8_t> to_master, to_slave;   // 事件循环：排队的字节
+static int pipe_m2s[2], pipe_s2m[2];                // 接收线程：管道
+
+static thread_local const char *stage = "主线程";   //!< 协程在哪里继续执行
+static std::atomic<bool> done;
+static int failures;
+
+//region 平台
+
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    TinyFrame *peer = (tf == &master) ? &slave : &master;
+
+    switch (mode) {
+        case Link::Sync:
+            TF_Accept(peer, buff, len);
+            break;
+        case Link::Queued:
+        {
+            std::vector<uint8_t> &queue = (tf == &master) ? to_slave : to_master;
+            queue.insert(queue.end(), buff, buff + len);
+            break;
+        }
+        case Link::Thread:
+            if (write((tf == &master) ? pipe_m2s[1] : pipe_s2m[1], buff, len) != (ssize_t) len) perror("write");
+            break;
+    }
+}
+
+bool TF_ClaimTx(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->tx_mutex);
+    return true;
+}
+
+void TF_ReleaseTx(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->tx_mutex);
+}
+
+void TF_ClaimRegistry(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+void TF_ReleaseRegistry(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+//endregion 平台
+
+//region 从站
+
+static TF_Result echoListener(TinyFrame *tf, TF_Msg *msg)
+{
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+static TF_Result silentListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    return TF_STAY;
+}
+
+//endregion 从站
+
+static void expect(bool ok, const char *what)
+{
+    if (!ok) failures++;
+    printf("  %s %s：%s\n", ok ? "OK  " : "失败", what, stage);
+}
+
+/** 主站的查询序列，写成顺序代码 */
+static tf::Detached session(TinyFrame *tf)
+{
+    static const uint8_t hello[] = "hello";
+
+    auto r = co_await tf::query_simple(tf, TYPE_ECHO, hello, sizeof(hello), 200);
+    expect(r && r.msg.len == sizeof(hello) && memcmp(r.msg.data, hello, sizeof(hello)) == 0, "回显");
+
+    r = co_await tf::query_simple(tf, TYPE_ECHO, nullptr, 0, 200);
+    expect(r && r.msg.len == 0, "空负载的回显");
+
+    r = co_await tf::query_simple(tf, TYPE_SILENT, hello, sizeof(hello), 3);
+    expect(r.status == tf::QueryStatus::Timeout, "超时");
+
+    done = true;
+}
+
+static void *slave_rx_thread(void *unused)
+{
+    (void) unused;
+    uint8_t buf[32];
+    ssize_t n;
+
+    while ((n = read(pipe_m2s[0], buf, sizeof(buf))) > 0) {
+        TF_Accept(&slave, buf, (uint32_t) n);
+    }
+    return NULL;
+}
+
+static void *master_rx_thread(void *unused)
+{
+    (void) unused;
+    uint8_t buf[32];
+    ssize_t n;
+
+    stage = "在接收线程的 TF_Accept() 中恢复";
+    while ((n = read(pipe_s2m[0], buf, sizeof(buf))) > 0) {
+        TF_Accept(&master, buf, (uint32_t) n);
+    }
+    return NULL;
+}
+
+/** 把排队的字节交给对方（交付过程中可能产生新的字节） */
+static void pump(std::vector<uint8_t> &queue, TinyFrame *tf)
+{
+    std::vector<uint8_t> bytes;
+    bytes.swap(queue);
+    if (!bytes.empty()) TF_Accept(tf, bytes.data(), (uint32_t) bytes.size());
+}
+
+static void run(Link link, const char *name)
+{
+    pthread_t srx, mrx;
+
+    printf("%s：\n", name);
+    mode = link;
+    done = false;
+    TF_InitStatic(&master, TF_MASTER);
+    TF_InitStatic(&slave, TF_SLAVE);
+    master.userdata = &link_master;
+    slave.userdata = &link_slave;
+    TF_AddTypeListener(&slave, TYPE_ECHO, echoListener);
+    TF_AddTypeListener(&slave, TYPE_SILENT, silentListener);
+
+    if (link == Link::Thread) {
+        if (pipe(pipe_m2s) != 0 || pipe(pipe_s2m) != 0) {
+            perror("pipe");
+            failures++;
+            return;
+        }
+        pthread_create(&srx, NULL, slave_rx_thread, NULL);
+        pthread_create(&mrx, NULL, master_rx_thread, NULL);
+    }
+
+    // 协程立即开始运行，直到第一次挂起才返回
+    stage = "在 session() 的初次调用中继续，没有挂起";
+    session(&master);
+
+    while (!done) {
+        if (link == Link::Queued) {
+            stage = "在主循环的 TF_Accept() 中恢复";
+            pump(to_slave, &slave);
+            pump(to_master, &master);
+        } else if (link == Link::Thread) {
+            usleep(1000);
+        }
+        stage = "在 TF_Tick() 中恢复";
+        TF_Tick(&master);
+        TF_Tick(&slave);
+    }
+
+    if (link == Link::Thread) {
+        close(pipe_m2s[1]);
+        close(pipe_s2m[1]);
+        pthread_join(srx, NULL);
+        pthread_join(mrx, NULL);
+        close(pipe_m2s[0]);
+        close(pipe_s2m[0]);
+    }
+}
+
+int main(void)
+{
+    pthread_mutex_init(&link_master.tx_mutex, NULL);
+    pthread_mutex_init(&link_master.reg_mutex, NULL);
+    pthread_mutex_init(&link_slave.tx_mutex, NULL);
+    pthread_mutex_init(&link_slave.reg_mutex, NULL);
+
+    run(Link::Sync, "同步链路");
+    run(Link::Queued, "事件循环");
+    run(Link::Thread, "接收线程");
+
+    printf("%s\n", failures ? "有检查失败" : "全部通过");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+//
+// C++17 包装器演示（utilities/tinyframe.hpp）
+//
+// 控制台（主站）查询传感器（从站）。两个 tf::Frame 的监听器都是处理器的成员函数，
+// 处理器的状态（读数、计数）保存在处理器对象中。演示：
+//   - 构造参数传递给处理器的构造函数
+//   - 类型监听器、带超时的查询（上下文通过 Message::userdata() 传递，也可以没有上下文）和通用监听器
+//   - 移动 Frame 之后监听器仍然调用新位置上的处理器
+// 两个实例在内存中直接相连：一端写出的字节立即交给另一端。
+//
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include "../../TinyFrame.h"
+#include "tinyframe.hpp"
+
+#define TYPE_READ    0x10   //!< 查询温度，响应 2 字节（0.1 度）
+#define TYPE_SET     0x11   //!< 设置温度，1 字节
+#define TYPE_UNKNOWN 0x7F   //!< 传感器不处理，查询会超时
+
+/** 两个实例的连接 */
+static TinyFrame *console_tf, *sensor_tf;
+
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    TF_Accept(tf == console_tf ? sensor_tf : console_tf, buff, len);
+}
+
+/** 从站的处理器 */
+struct Sensor {
+    int decidegrees;
+    int reads = 0;
+
+    explicit Sensor(int degrees) : decidegrees(degrees * 10) {}
+
+    TF_Result on_read(tf::Frame<Sensor> &f, tf::Message msg)
+    {
+        const uint8_t value[2] = {static_cast<uint8_t>(decidegrees >> 8), static_cast<uint8_t>(decidegrees)};
+        reads++;
+        f.respond(msg, value);
+        return TF_STAY;
+    }
+
+    TF_Result on_set(tf::Frame<Sensor> &, tf::Message msg)
+    {
+        if (msg.payload().size() != 1) return TF_NEXT;
+        decidegrees = msg.payload()[0] * 10;
+        return TF_STAY;
+    }
+};
+
+/** 主站的处理器 */
+struct Console {
+    int last = -1;
+    int timeouts = 0;
+    int unhandled = 0;
+
+    /** 查询的响应或超时，ctx 为查询的名称 */
+    TF_Result on_value(tf::Frame<Console> &, tf::Message msg)
+    {
+        const char *name = msg.userdata() ? static_cast<const char *>(msg.userdata()) : "（无上下文）";
+
+        if (msg.timed_out()) {
+            printf("  %s：超时\n", name);
+            timeouts++;
+            return TF_CLOSE;
+        }
+        tf::Bytes p = msg.payload();
+        last = (p[0] << 8) | p[1];
+        printf("  %s：%d.%d 度\n", name, last / 10, last % 10);
+        return TF_CLOSE;
+    }
+};
+
+/** 普通函数也可以作为监听器 */
+static TF_Result log_unhandled(tf::Frame<Console> &f, tf::Message msg)
+{
+    printf("  未处理的帧，类型 0x%02X\n", msg.type());
+    f.handler().unhandled++;
+    return TF_STAY;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    tf::Frame<Sensor> sensor(TF_SLAVE, 21);     // 21 传递给 Sensor 的构造函数
+    tf::Frame<Console> console(TF_MASTER);
+    sensor_tf = sensor.get();
+    console_tf = console.get();
+
+    sensor.add_type_listener<&Sensor::on_read>(TYPE_READ);
+    sensor.add_type_listener<&Sensor::on_set>(TYPE_SET);
+    console.add_generic_listener<&log_unhandled>();
+
+    printf("查询：\n");
+    console.query<&Console::on_value>(TYPE_READ, {}, 10, (void *) "读取");
+    if (console.handler().last != 210) failures++;
+
+    const uint8_t degrees[] = {25};
+    console.send(TYPE_SET, degrees);
+    console.query<&Console::on_value>(TYPE_READ, {}, 10, (void *) "设置后读取");
+    if (console.handler().last != 250) failures++;
+
+    // 移动后底层实例不变，userdata 指向新的 Frame，监听器调用新位置上的处理器
+    printf("移动传感器的 Frame：\n");
+    tf::Frame<Sensor> moved(std::move(sensor));
+    console.query<&Console::on_value>(TYPE_READ, {}, 10, (void *) "移动后读取");
+    if (moved.handler().reads != 3 || moved.get() != sensor_tf || sensor.get() != nullptr) failures++;
+
+    printf("超时：\n");
+    console.query<&Console::on_value>(TYPE_UNKNOWN, {}, 3, (void *) "未知类型");
+    for (int i = 0; i < 5; i++) console.tick();
+    if (console.handler().timeouts != 1) failures++;
+
+    // 没有 ctx 的查询也要收到超时，Fn 看到的 userdata 为 nullptr
+    console.query<&Console::on_value>(TYPE_UNKNOWN, {}, 3);
+    for (int i = 0; i < 5; i++) console.tick();
+    if (console.handler().timeouts != 2) failures++;
+
+    // 传感器发来控制台没有类型监听器的帧，由通用监听器处理
+    printf("通用监听器：\n");
+    moved.send(0x42);
+    if (console.handler().unhandled != 1) failures++;
+
+    printf("%s\n", failures ? "有检查失败" : "全部通过");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+//
+// C++ 引擎与 C 实例互通演示
+//
+// C 实例（TinyFrame.c，帧格式由 TF_Config.h 和 Makefile 决定）与两种 C++ 引擎对话：
+//   tf::Engine    - 格式在编译期由同样的宏确定（utilities/tf_engine.hpp）
+//   tf::AnyEngine - 格式在运行时由 tf::Format 描述（utilities/tf_format.hpp）
+// 两个方向都测试：查询和响应、多部分帧、比发送缓冲区长的负载和空负载，
+// 另外测试 AnyMsg 中超出格式范围的长度和类型被拒绝。
+// 两端在内存中直接相连：一端写出的字节立即交给另一端。
+//
+
+#include <cstdio>
+#include <cstring>
+#include "../../TinyFrame.h"
+#include "tf_engine.hpp"
+#include "tf_format.hpp"
+
+#define TYPE_ECHO 0x21  //!< 对方把每个字节加一后响应
+#define TYPE_NOTE 0x22  //!< 对方只记录负载
+
+#if TF_CKSUM_TYPE == TF_CKSUM_NONE
+    #define CKSUM_NAME "NONE"
+    using Cksum = tf::checksum::None;
+    static const tf::ChecksumKind cksum_kind = tf::ChecksumKind::None;
+#elif TF_CKSUM_TYPE == TF_CKSUM_XOR
+    #define CKSUM_NAME "XOR"
+    using Cksum = tf::checksum::Xor;
+    static const tf::ChecksumKind cksum_kind = tf::ChecksumKind::Xor;
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC8
+    #define CKSUM_NAME "CRC8"
+    using Cksum = tf::checksum::Crc8;
+    static const tf::ChecksumKind cksum_kind = tf::ChecksumKind::Crc8;
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC16
+    #define CKSUM_NAME "CRC16"
+    using Cksum = tf::checksum::Crc16;
+    static const tf::ChecksumKind cksum_kind = tf::ChecksumKind::Crc16;
+#elif TF_CKSUM_TYPE == TF_CKSUM_CRC32
+    #define CKSUM_NAME "CRC32"
+    using Cksum = tf::checksum::Crc32;
+    static const tf::ChecksumKind cksum_kind = tf::ChecksumKind::Crc32;
+#endif
+
+/** 编译期引擎的参数，与 TF_Config.h 一致 */
+struct CompiledOptions : tf::DefaultOptions {
+    static constexpr int sof_byte = TF_USE_SOF_BYTE ? TF_SOF_BYTE : -1;
+    static void error(const char *message) { printf("[C++] %s\n", message); }
+};
+
+using Compiled = tf::Engine<TF_ID, TF_LEN, TF_TYPE, Cksum, TF_MAX_PAYLOAD_RX, TF_SENDBUF_LEN, CompiledOptions>;
+
+/** 一方收到的内容 */
+struct Inbox {
+    bool got_response;
+    uint8_t response[TF_MAX_PAYLOAD_RX];
+    uint32_t response_len;
+    uint32_t notes;
+    uint8_t note[TF_MAX_PAYLOAD_RX];
+    uint32_t note_len;
+};
+
+static TinyFrame c_tf;
+static Inbox c_inbox, cpp_inbox;
+static void (*to_cpp)(const uint8_t *buff, uint32_t len);  //!< C 实例写出的字节交给当前的 C++ 引擎
+static uint8_t payload[100];
+static int checks, failures;
+
+static void check(bool ok, const char *what)
+{
+    checks++;
+    if (!ok) failures++;
+    printf("  %s %s\n", ok ? "OK  " : "失败", what);
+}
+
+static void store(uint8_t *dest, uint32_t *dest_len, const uint8_t *data, uint32_t len)
+{
+    if (len > 0) memcpy(dest, data, len);
+    *dest_len = len;
+}
+
+/** 对方的响应是否为 payload 的每个字节加一 */
+static bool is_echo(const Inbox &in, uint32_t len)
+{
+    if (!in.got_response || in.response_len != len) return false;
+    for (uint32_t i = 0; i < len; i++) {
+        if (in.response[i] != (uint8_t) (payload[i] + 1)) return false;
+    }
+    return true;
+}
+
+static bool is_note(const Inbox &in, uint32_t notes, uint32_t len)
+{
+    return in.notes == notes && in.note_len == len && (len == 0 || memcmp(in.note, payload, len) == 0);
+}
+
+//region C 实例
+
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    (void) tf;
+    to_cpp(buff, len);
+}
+
+static TF_Result c_echo(TinyFrame *tf, TF_Msg *msg)
+{
+    uint8_t buf[TF_MAX_PAYLOAD_RX];
+
+    for (uint32_t i = 0; i < msg->len; i++) buf[i] = (uint8_t) (msg->data[i] + 1);
+    msg->data = buf;
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+static TF_Result c_note(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    c_inbox.notes++;
+    store(c_inbox.note, &c_inbox.note_len, msg->data, msg->len);
+    return TF_STAY;
+}
+
+static TF_Result c_response(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    c_inbox.got_response = true;
+    store(c_inbox.response, &c_inbox.response_len, msg->data, msg->len);
+    return TF_CLOSE;
+}
+
+//endregion C 实例
+
+//region C++ 引擎
+
+/** 一种 C++ 引擎的监听器和输出函数（E 为引擎，M 为它的消息类型） */
+template <class E, class M>
+struct Side {
+    static inline E *engine = nullptr;
+
+    static void write(E &tf, const uint8_t *buff, std::size_t len)
+    {
+        (void) tf;
+        TF_Accept(&c_tf, buff, (uint32_t) len);
+    }
+
+    static void from_c(const uint8_t *buff, uint32_t len) { engine->accept(buff, len); }
+
+    static tf::Result echo(E &tf, M &msg)
+    {
+        uint8_t buf[TF_MAX_PAYLOAD_RX];
+
+        for (uint32_t i = 0; i < msg.len; i++) buf[i] = (uint8_t) (msg.data[i] + 1);
+        msg.data = buf;
+        tf.respond(msg);
+        return tf::Result::Stay;
+    }
+
+    static tf::Result note(E &tf, M &msg)
+    {
+        (void) tf;
+        cpp_inbox.notes++;
+        store(cpp_inbox.note, &cpp_inbox.note_len, msg.data, msg.len);
+        return tf::Result::Stay;
+    }
+
+    static tf::Result response(E &tf, M &msg)
+    {
+        (void) tf;
+        cpp_inbox.got_response = true;
+        store(cpp_inbox.response, &cpp_inbox.response_len, msg.data, msg.len);
+        return tf::Result::Close;
+    }
+};
+
+//endregion C++ 引擎
+
+/** 在 C 实例和一个 C++ 引擎之间进行所有交换 */
+template <class E, class M>
+static void exercise(E &eng)
+{
+    using S = Side<E, M>;
+    static const uint32_t sizes[] = {0, 5, sizeof(payload)}; // 100 字节需要多次写出（TF_SENDBUF_LEN 32）
+    char what[64];
+    TF_Msg cmsg;
+    M msg;
+
+    S::engine = &eng;
+    to_cpp = S::from_c;
+    eng.add_type_listener(TYPE_ECHO, S::echo);
+    eng.add_type_listener(TYPE_NOTE, S::note);
+    c_inbox = Inbox();
+    cpp_inbox = Inbox();
+
+    for (uint32_t size : sizes) {
+        // C 查询，C++ 响应
+        c_inbox.got_response = false;
+        TF_ClearMsg(&cmsg);
+        cmsg.type = TYPE_ECHO;
+        cmsg.data = payload;
+        cmsg.len = (TF_LEN) size;
+        TF_Query(&c_tf, &cmsg, c_response, NULL, 0);
+        snprintf(what, sizeof(what), "C -> C++ 查询，%u 字节", size);
+        check(is_echo(c_inbox, size), what);
+
+        // C++ 查询，C 响应
+        cpp_inbox.got_response = false;
+        msg = M();
+        msg.type = TYPE_ECHO;
+        msg.data = payload;
+        msg.len = size;
+        eng.query(msg, S::response, nullptr, 0);
+        snprintf(what, sizeof(what), "C++ -> C 查询，%u 字节", size);
+        check(is_echo(cpp_inbox, size), what);
+    }
+
+    // 多部分帧，负载分 10 次传入
+    TF_ClearMsg(&cmsg);
+    cmsg.type = TYPE_NOTE;
+    cmsg.len = sizeof(payload);
+    TF_Send_Multipart(&c_tf, &cmsg);
+    for (uint32_t pos = 0; pos < sizeof(payload); pos += 10) TF_Multipart_Payload(&c_tf, payload + pos, 10);
+    TF_Multipart_Close(&c_tf);
+    check(is_note(cpp_inbox, 1, sizeof(payload)), "C -> C++ 多部分帧");
+
+    msg = M();
+    msg.type = TYPE_NOTE;
+    msg.len = sizeof(payload);
+    eng.send_multipart(msg);
+    for (uint32_t pos = 0; pos < sizeof(payload); pos += 10) eng.multipart_payload(payload + pos, 10);
+    eng.multipart_close();
+    check(is_note(c_inbox, 1, sizeof(payload)), "C++ -> C 多部分帧");
+
+    // 空负载
+    TF_SendSimple(&c_tf, TYPE_NOTE, NULL, 0);
+    check(is_note(cpp_inbox, 2, 0), "C -> C++ 空负载");
+
+    msg = M();
+    msg.type = TYPE_NOTE;
+    eng.send(msg);
+    check(is_note(c_inbox, 2, 0), "C++ -> C 空负载");
+}
+
+int main(void)
+{
+    for (uint32_t i = 0; i < sizeof(payload); i++) payload[i] = (uint8_t) (i * 7);
+
+    printf("格式：ID/LEN/TYPE %d/%d/%d 字节，校验和 %s，SOF %d\n",
+           TF_ID_BYTES, TF_LEN_BYTES, TF_TYPE_BYTES, CKSUM_NAME, TF_USE_SOF_BYTE);
+
+    TF_InitStatic(&c_tf, TF_SLAVE);
+    TF_AddTypeListener(&c_tf, TYPE_ECHO, c_echo);
+    TF_AddTypeListener(&c_tf, TYPE_NOTE, c_note);
+
+    printf("tf::Engine（编译期格式）：\n");
+    Compiled compiled(tf::Peer::Master, Side<Compiled, Compiled::Msg>::write);
+    exercise<Compiled, Compiled::Msg>(compiled);
+
+    printf("tf::AnyEngine（运行时格式）：\n");
+    tf::Format fmt;
+    fmt.id_bytes = TF_ID_BYTES;
+    fmt.len_bytes = TF_LEN_BYTES;
+    fmt.type_bytes = TF_TYPE_BYTES;
+    fmt.checksum = cksum_kind;
+    fmt.use_sof = TF_USE_SOF_BYTE;
+    fmt.sof_byte = TF_SOF_BYTE;
+    fmt.max_payload_rx = TF_MAX_PAYLOAD_RX;
+    fmt.sendbuf_len = TF_SENDBUF_LEN;
+    auto any = tf::make_engine(fmt, tf::Peer::Master, Side<tf::AnyEngine, tf::AnyMsg>::write);
+    if (!any) {
+        printf("make_engine() 不支持此格式\n");
+        return 1;
+    }
+    exercise<tf::AnyEngine, tf::AnyMsg>(*any);
+
+    // AnyMsg 的字段是 32 位的，超出格式宽度的值不能截断后发送
+    tf::AnyMsg msg;
+#if TF_LEN_BYTES < 4
+    {
+        msg.type = TYPE_NOTE;
+        msg.len = 1u << (TF_LEN_BYTES * 8);
+        msg.data = payload; // 不会被读取
+        check(!any->send(msg), "超出 LEN 宽度的长度被拒绝");
+    }
+#endif
+#if TF_TYPE_BYTES < 4
+    {
+        msg = tf::AnyMsg();
+        msg.type = TYPE_NOTE | (1u << (TF_TYPE_BYTES * 8));
+        check(!any->send(msg), "超出 TYPE 宽度的类型被拒绝");
+    }
+#endif
+
+    printf("%d 项检查，%d 项失败\n", checks, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+//
+// 同步查询演示的配置
+//
+// TF_USE_RX_POOL 由 Makefile 用 -D 覆盖：池很小，如果响应缓冲区没有归还，很快就会耗尽。
+//
+
+#ifndef TF_CONFIG_H
+#define TF_CONFIG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define TF_ID_BYTES     1
+#define TF_LEN_BYTES    2
+#define TF_TYPE_BYTES   1
+#define TF_CKSUM_TYPE TF_CKSUM_CRC16
+#define TF_USE_SOF_BYTE 1
+#define TF_SOF_BYTE     0x01
+typedef uint16_t TF_TICKS;
+typedef uint8_t TF_COUNT;
+#define TF_MAX_PAYLOAD_RX 64
+#ifndef TF_USE_RX_POOL
+#define TF_USE_RX_POOL 0
+#endif
+#define TF_RX_POOL_SLABS 4
+#define TF_SENDBUF_LEN 64
+#define TF_MAX_ID_LST   10
+#define TF_MAX_TYPE_LST 10
+#define TF_MAX_GEN_LST  5
+#define TF_PARSER_TIMEOUT_TICKS 10
+#define TF_USE_MUTEX 1
+#define TF_USE_REGISTRY_LOCK 1
+
+#define TF_Error(format, ...) printf("[TF] " format "\n", ##__VA_ARGS__)
+
+#endif //TF_CONFIG_H
@@ -0,0 +1,211 @@
+//
+// 同步查询演示（utilities/query_sync.h）
+//
+// 主线程用 TF_QuerySync() 查询从站并阻塞等待，两个接收线程通过管道分别为主站和从站调用 TF_Accept()。
+// 演示的情况：
+//   响应     - 从站回显负载，调用者得到负载的副本（池模式下接管接收缓冲区）
+//   空响应   - 从站响应 0 字节，data 为 NULL，TF_QuerySyncRelease() 没有需要释放的东西
+//   超时     - 从站不响应
+//   迟到     - 从站在调用者放弃之后才响应，响应交给主站的通用监听器
+// 最后连续查询多次，池模式下如果响应缓冲区没有归还，池会耗尽而查询超时。
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../../TinyFrame.h"
+#include "query_sync.h"
+
+#define TYPE_ECHO   1   //!< 回显负载
+#define TYPE_EMPTY  2   //!< 以空负载响应
+#define TYPE_SILENT 3   //!< 不响应
+#define TYPE_SLOW   4   //!< 200 毫秒后才响应
+
+#define REPEAT 20
+
+/** 每个实例的锁 */
+struct link {
+    int fd_out;                  //!< 写入对方的管道
+    pthread_mutex_t tx_mutex;
+    pthread_mutex_t reg_mutex;
+};
+
+static TinyFrame tf_master, tf_slave;
+static struct link link_master, link_slave;
+static int pipe_m2s[2], pipe_s2m[2];
+static volatile int late_responses = 0;
+static int failures = 0;
+
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    struct link *lnk = tf->userdata;
+    if (write(lnk->fd_out, buff, len) != (ssize_t) len) {
+        perror("write");
+    }
+}
+
+bool TF_ClaimTx(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->tx_mutex);
+    return true;
+}
+
+void TF_ReleaseTx(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->tx_mutex);
+}
+
+void TF_ClaimRegistry(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+void TF_ReleaseRegistry(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+//region 从站
+
+TF_Result echoListener(TinyFrame *tf, TF_Msg *msg)
+{
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+TF_Result emptyListener(TinyFrame *tf, TF_Msg *msg)
+{
+    msg->data = NULL;
+    msg->len = 0;
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+TF_Result silentListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    return TF_STAY;
+}
+
+TF_Result slowListener(TinyFrame *tf, TF_Msg *msg)
+{
+    usleep(200 * 1000);
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+//endregion 从站
+
+/** 主站：没有 ID 监听器的响应（调用者已放弃等待） */
+TF_Result lateListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    printf("  迟到的响应，ID %d，类型 %d\n", (int) msg->frame_id, (int) msg->type);
+    __atomic_add_fetch(&late_responses, 1, __ATOMIC_RELAXED);
+    return TF_STAY;
+}
+
+static void *rx_thread(void *arg)
+{
+    TinyFrame *tf = arg;
+    int fd = (tf == &tf_master) ? pipe_s2m[0] : pipe_m2s[0];
+    uint8_t buf[32];
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        TF_Accept(tf, buf, (uint32_t) n);
+    }
+    return NULL;
+}
+
+static void link_init(TinyFrame *tf, struct link *lnk, TF_Peer peer, int fd_out)
+{
+    lnk->fd_out = fd_out;
+    pthread_mutex_init(&lnk->tx_mutex, NULL);
+    pthread_mutex_init(&lnk->reg_mutex, NULL);
+    tf->userdata = lnk;
+    TF_InitStatic(tf, peer);
+}
+
+static void check(bool ok, const char *what)
+{
+    if (!ok) failures++;
+    printf("%s %s\n", ok ? "OK  " : "失败", what);
+}
+
+/** 发送同步查询，返回是否收到响应 */
+static bool query(TF_TYPE type, const char *text, uint32_t timeout_ms, TF_Msg *resp)
+{
+    TF_Msg msg;
+
+    TF_ClearMsg(&msg);
+    msg.type = type;
+    msg.data = (const uint8_t *) text;
+    msg.len = (TF_LEN) (text ? strlen(text) + 1 : 0);
+    return TF_QuerySync(&tf_master, &msg, timeout_ms, resp);
+}
+
+int main(void)
+{
+    const char *hello = "Hello TinyFrame";
+    pthread_t mrx, srx;
+    TF_Msg resp;
+    bool ok;
+    int i, answered = 0;
+
+    if (pipe(pipe_m2s) != 0 || pipe(pipe_s2m) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    link_init(&tf_master, &link_master, TF_MASTER, pipe_m2s[1]);
+    link_init(&tf_slave, &link_slave, TF_SLAVE, pipe_s2m[1]);
+
+    TF_AddTypeListener(&tf_slave, TYPE_ECHO, echoListener);
+    TF_AddTypeListener(&tf_slave, TYPE_EMPTY, emptyListener);
+    TF_AddTypeListener(&tf_slave, TYPE_SILENT, silentListener);
+    TF_AddTypeListener(&tf_slave, TYPE_SLOW, slowListener);
+    TF_AddGenericListener(&tf_master, lateListener);
+
+    pthread_create(&mrx, NULL, rx_thread, &tf_master);
+    pthread_create(&srx, NULL, rx_thread, &tf_slave);
+
+    printf("TF_USE_RX_POOL %d\n", TF_USE_RX_POOL);
+
+    ok = query(TYPE_ECHO, hello, 1000, &resp);
+    check(ok && resp.len == strlen(hello) + 1 && memcmp(resp.data, hello, resp.len) == 0, "响应");
+    if (ok) TF_QuerySyncRelease(&tf_master, &resp);
+
+    ok = query(TYPE_EMPTY, hello, 1000, &resp);
+    check(ok && resp.len == 0 && resp.data == NULL, "空响应");
+    if (ok) TF_QuerySyncRelease(&tf_master, &resp);
+
+    ok = query(TYPE_SILENT, hello, 50, &resp);
+    check(!ok, "超时");
+
+    ok = query(TYPE_SLOW, hello, 50, &resp);
+    check(!ok, "迟到的响应之前超时");
+    usleep(300 * 1000);
+    check(late_responses == 1, "迟到的响应交给通用监听器");
+
+    // 空请求、空响应交替，每次都释放
+    for (i = 0; i < REPEAT; i++) {
+        ok = query((i % 2) ? TYPE_EMPTY : TYPE_ECHO, (i % 3) ? hello : NULL, 1000, &resp);
+        if (ok) {
+            answered++;
+            TF_QuerySyncRelease(&tf_master, &resp);
+        }
+    }
+    check(answered == REPEAT, "连续查询（响应缓冲区都已归还）");
+
+    // 关闭写入端，接收线程读到结束后退出
+    close(pipe_m2s[1]);
+    close(pipe_s2m[1]);
+    pthread_join(mrx, NULL);
+    pthread_join(srx, NULL);
+
+    printf("%s\n", failures ? "有检查失败" : "全部通过");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+#include "../../TinyFrame.h"
+#include "../utils.h"
+
+TinyFrame *demo_tf;
+
+/** 延迟处理队列 - 保存接管的负载 */
+#define DEFERRED_MAX 3
+static TF_Msg deferred[DEFERRED_MAX];
+static int deferred_count = 0;
+
+/**
+ * 此函数应在应用程序代码中定义。
+ * 它实现最底层 - 将字节发送到 UART（或其他）
+ */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    // 将其发回，就像我们接收到它一样
+    TF_Accept(tf, buff, len);
+}
+
+/** 接管负载而不复制，稍后在主循环中处理 */
+TF_Result deferListener(TinyFrame *tf, TF_Msg *msg)
+{
+    if (deferred_count == DEFERRED_MAX) {
+        printf("队列已满，立即处理\n");
+        dumpFrameInfo(msg);
+        return TF_STAY;
+    }
+
+    if (TF_TakePayload(tf, msg) != NULL) {
+        // msg->data 现在归我们所有，回调返回后仍然有效
+        deferred[deferred_count++] = *msg;
+    }
+    return TF_STAY;
+}
+
+int main(void)
+{
+    int i;
+    char text[32];
+
+    demo_tf = TF_Init(TF_MASTER);
+    TF_AddGenericListener(demo_tf, deferListener);
+
+    printf("------ 发送消息，监听器接管负载 --------\n");
+
+    for (i = 0; i < 5; i++) {
+        snprintf(text, sizeof(text), "Deferred message %d", i);
+        TF_SendSimple(demo_tf, 0x22, (pu8) text, (TF_LEN) (strlen(text) + 1));
+    }
+
+    printf("------ 延迟处理 --------\n");
+
+    for (i = 0; i < deferred_count; i++) {
+        dumpFrameInfo(&deferred[i]);
+        TF_ReleasePayload(demo_tf, deferred[i].data);
+    }
+
+    TF_DeInit(demo_tf);
+    return 0;
+}
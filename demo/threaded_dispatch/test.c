@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "../../TinyFrame.h"
+#include "../utils.h"
+
+#define FRAME_COUNT 50
+
+static TinyFrame tf_sender;    // 写入管道的一端
+static TinyFrame tf_receiver;  // 从管道解析，在分发线程中运行监听器
+
+static int pipefd[2];
+static sem_t dispatch_sem;
+static volatile bool rx_done = false;
+static pthread_mutex_t tx_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** 发送端将字节写入管道 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    (void)tf;
+    if (write(pipefd[1], buff, len) != (ssize_t) len) {
+        perror("write");
+    }
+}
+
+bool TF_ClaimTx(TinyFrame *tf)
+{
+    (void)tf;
+    pthread_mutex_lock(&tx_mutex);
+    return true;
+}
+
+void TF_ReleaseTx(TinyFrame *tf)
+{
+    (void)tf;
+    pthread_mutex_unlock(&tx_mutex);
+}
+
+/** 解析器排队了一帧 - 唤醒分发线程 */
+void TF_NotifyDispatch(TinyFrame *tf, uint32_t lane)
+{
+    (void)tf;
+    (void)lane;
+    sem_post(&dispatch_sem);
+}
+
+/** 很慢的监听器 - 在解析器线程中运行会阻塞接收 */
+TF_Result slowListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void)tf;
+    usleep(2000);
+    printf("处理帧 ID %02Xh: %.*s\n", msg->frame_id, (int) msg->len, msg->data);
+    return TF_STAY;
+}
+
+/** 分发线程 */
+static void *dispatch_thread(void *unused)
+{
+    (void)unused;
+    uint32_t total = 0;
+
+    while (true) {
+        sem_wait(&dispatch_sem);
+        total += TF_Dispatch(&tf_receiver);
+        if (rx_done) break;
+    }
+    printf("分发线程处理了 %u 帧\n", total);
+    return NULL;
+}
+
+/** 接收线程 - 只运行解析器 */
+static void *rx_thread(void *unused)
+{
+    (void)unused;
+    uint8_t buf[64];
+    ssize_t n;
+
+    while ((n = read(pipefd[0], buf, sizeof(buf))) > 0) {
+        TF_Accept(&tf_receiver, buf, (uint32_t) n);
+    }
+    rx_done = true;
+    sem_post(&dispatch_sem); // 处理剩余的帧并退出
+    return NULL;
+}
+
+int main(void)
+{
+    int i;
+    char text[32];
+    pthread_t rx, disp;
+
+    if (pipe(pipefd) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    sem_init(&dispatch_sem, 0, 0);
+
+    TF_InitStatic(&tf_sender, TF_MASTER);
+    TF_InitStatic(&tf_receiver, TF_SLAVE);
+    TF_AddGenericListener(&tf_receiver, slowListener);
+
+    pthread_create(&rx, NULL, rx_thread, NULL);
+    pthread_create(&disp, NULL, dispatch_thread, NULL);
+
+    for (i = 0; i < FRAME_COUNT; i++) {
+        snprintf(text, sizeof(text), "frame %d", i);
+        TF_SendSimple(&tf_sender, 0x10, (pu8) text, (TF_LEN) strlen(text));
+
+        // 以突发方式发送，比监听器快得多 - 队列吸收突发，解析器不会被阻塞
+        if (i % 5 == 4) usleep(20000);
+    }
+
+    close(pipefd[1]);
+    pthread_join(rx, NULL);
+    pthread_join(disp, NULL);
+    return 0;
+}
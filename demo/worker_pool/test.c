@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "../../TinyFrame.h"
+#include "../utils.h"
+
+#define FRAME_COUNT 300
+#define TYPE_COUNT 6
+#define MAX_OUTSTANDING 8
+
+/** 每个实例的锁 */
+struct link {
+    int fd_out;                  //!< 写入对方的管道
+    pthread_mutex_t tx_mutex;
+    pthread_mutex_t reg_mutex;
+};
+
+static TinyFrame tf_master;      // 发送请求，在接收线程中直接分发响应
+static TinyFrame tf_slave;       // 监听器在工作线程池中运行
+static struct link link_master, link_slave;
+
+static int pipe_m2s[2], pipe_s2m[2];
+static sem_t lane_sem[TF_DISPATCH_LANES];
+static volatile bool stop = false;
+
+static uint32_t next_seq[TYPE_COUNT];   // 从站：每种类型期望的下一个序号
+static int order_errors = 0;
+static volatile int responses = 0;
+
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    struct link *lnk = tf->userdata;
+    if (write(lnk->fd_out, buff, len) != (ssize_t) len) {
+        perror("write");
+    }
+}
+
+bool TF_ClaimTx(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->tx_mutex);
+    return true;
+}
+
+void TF_ReleaseTx(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->tx_mutex);
+}
+
+void TF_ClaimRegistry(TinyFrame *tf)
+{
+    pthread_mutex_lock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+void TF_ReleaseRegistry(TinyFrame *tf)
+{
+    pthread_mutex_unlock(&((struct link *) tf->userdata)->reg_mutex);
+}
+
+/** 从站的帧由工作线程处理；主站在接收线程中直接调用 TF_Dispatch() */
+void TF_NotifyDispatch(TinyFrame *tf, uint32_t lane)
+{
+    if (tf == &tf_slave) {
+        sem_post(&lane_sem[lane]);
+    }
+}
+
+/** CPU 密集的监听器（例如解码和校准传感器数据块），在工作线程中运行并回复 */
+TF_Result heavyListener(TinyFrame *tf, TF_Msg *msg)
+{
+    uint32_t seq, i, acc = 0;
+
+    memcpy(&seq, msg->data, sizeof(seq));
+
+    // 同一类型在同一个通道中，必须按顺序到达
+    if (seq != next_seq[msg->type]) {
+        printf("类型 %d 顺序错误：%u != %u\n", msg->type, seq, next_seq[msg->type]);
+        order_errors++;
+    }
+    next_seq[msg->type] = seq + 1;
+
+    for (i = 0; i < 200000; i++) {
+        acc = acc * 31 + i;
+    }
+
+    msg->data = (const uint8_t *) &acc;
+    msg->len = sizeof(acc);
+    TF_Respond(tf, msg);
+    return TF_STAY;
+}
+
+/** 主站收到响应 */
+TF_Result responseListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void)tf;
+    (void)msg;
+    __atomic_add_fetch(&responses, 1, __ATOMIC_RELAXED);
+    return TF_STAY;
+}
+
+static void *worker_thread(void *arg)
+{
+    uint32_t lane = (uint32_t) (uintptr_t) arg;
+    uint32_t total = 0;
+
+    while (!stop) {
+        sem_wait(&lane_sem[lane]);
+        total += TF_DispatchLane(&tf_slave, lane);
+    }
+    printf("工作线程 %u 处理了 %u 帧\n", lane, total);
+    return NULL;
+}
+
+static void *slave_rx_thread(void *unused)
+{
+    (void)unused;
+    uint8_t buf[32];
+    ssize_t n;
+
+    while ((n = read(pipe_m2s[0], buf, sizeof(buf))) > 0) {
+        TF_Accept(&tf_slave, buf, (uint32_t) n);
+    }
+    return NULL;
+}
+
+static void *master_rx_thread(void *unused)
+{
+    (void)unused;
+    uint8_t buf[32];
+    ssize_t n;
+
+    while ((n = read(pipe_s2m[0], buf, sizeof(buf))) > 0) {
+        TF_Accept(&tf_master, buf, (uint32_t) n);
+        TF_Dispatch(&tf_master);
+    }
+    return NULL;
+}
+
+static void link_init(TinyFrame *tf, struct link *lnk, TF_Peer peer, int fd_out)
+{
+    lnk->fd_out = fd_out;
+    pthread_mutex_init(&lnk->tx_mutex, NULL);
+    pthread_mutex_init(&lnk->reg_mutex, NULL);
+    tf->userdata = lnk;
+    TF_InitStatic(tf, peer);
+}
+
+int main(void)
+{
+    uint32_t i, lane;
+    uint32_t seq[TYPE_COUNT] = {0};
+    TF_TYPE type;
+    pthread_t workers[TF_DISPATCH_LANES], srx, mrx;
+
+    if (pipe(pipe_m2s) != 0 || pipe(pipe_s2m) != 0) {
+        perror("pipe");
+        return 1;
+    }
+
+    link_init(&tf_master, &link_master, TF_MASTER, pipe_m2s[1]);
+    link_init(&tf_slave, &link_slave, TF_SLAVE, pipe_s2m[1]);
+
+    for (type = 0; type < TYPE_COUNT; type++) {
+        TF_AddTypeListener(&tf_slave, type, heavyListener);
+    }
+    TF_AddGenericListener(&tf_master, responseListener);
+
+    for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+        sem_init(&lane_sem[lane], 0, 0);
+        pthread_create(&workers[lane], NULL, worker_thread, (void *) (uintptr_t) lane);
+    }
+    pthread_create(&srx, NULL, slave_rx_thread, NULL);
+    pthread_create(&mrx, NULL, master_rx_thread, NULL);
+
+    for (i = 0; i < FRAME_COUNT; i++) {
+        // 限制未完成的请求数，使队列不会溢出
+        while (i - (uint32_t) responses >= MAX_OUTSTANDING) usleep(100);
+
+        type = (TF_TYPE) (i % TYPE_COUNT);
+        TF_SendSimple(&tf_master, type, (const uint8_t *) &seq[type], sizeof(uint32_t));
+        seq[type]++;
+    }
+
+    while (responses < FRAME_COUNT) usleep(1000);
+
+    stop = true;
+    for (lane = 0; lane < TF_DISPATCH_LANES; lane++) {
+        sem_post(&lane_sem[lane]);
+        pthread_join(workers[lane], NULL);
+    }
+
+    printf("收到 %d 个响应，顺序错误 %d 个\n", responses, order_errors);
+    return 0;
+}
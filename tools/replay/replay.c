@@ -0,0 +1,287 @@
+//
+// 抓包文件重放工具
+//
+// 用 mmap() 映射抓包文件（见 utilities/tf_capfile.h），把录制的字节块按原样传给 TF_Accept()，
+// 可以尽可能快（测量解析器的吞吐量），也可以按原始的时间间隔（重现生产环境中的现象）。
+//
+//   replay.bin [-t] [-n 次数] [-d rx|tx] 文件      重放
+//   replay.bin -g 文件 [帧数] [波特率]              生成一个合成的抓包文件
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../TinyFrame.h"
+#include "tf_capfile.h"
+
+static TinyFrame replay_tf;
+static uint64_t frames_dispatched;
+
+// 生成模式的状态
+static TinyFrame gen_tx, gen_rx;
+static FILE *gen_file;
+static uint64_t gen_now;        //!< 模拟的时钟（纳秒）
+static uint64_t gen_byte_ns;    //!< 线路上一个字节的时间
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+uint64_t TF_Timestamp(void)
+{
+    return gen_now;
+}
+
+/** 生成模式：发送方的输出录制为发送的字节，同时就是接收方录制的字节 */
+void TF_WriteImpl(TinyFrame *tf, const uint8_t *buff, uint32_t len)
+{
+    if (tf != &gen_tx) return;
+
+    TF_CapFileWriteBytes(gen_file, TF_CAPREC_TX_BYTES, gen_tx.usertag, gen_now, buff, len);
+    TF_CapFileWriteBytes(gen_file, TF_CAPREC_RX_BYTES, gen_rx.usertag, gen_now, buff, len);
+    gen_now += len * gen_byte_ns;
+    TF_Accept(&gen_rx, buff, len);
+}
+
+static TF_Result countListener(TinyFrame *tf, TF_Msg *msg)
+{
+    (void) tf;
+    (void) msg;
+    frames_dispatched++;
+    return TF_STAY;
+}
+
+//region 生成
+
+/** 固定种子的 xorshift，使生成的文件可以重现 */
+static uint32_t gen_random(void)
+{
+    static uint32_t x = 2463534242u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+/** 负载长度的分布：大多是短帧，少数是长帧 */
+static TF_LEN gen_payload_len(void)
+{
+    uint32_t r = gen_random() % 100;
+    if (r < 70) return (TF_LEN) (gen_random() % 17);
+    if (r < 95) return (TF_LEN) (16 + gen_random() % 113);
+    return (TF_LEN) (128 + gen_random() % (TF_MAX_PAYLOAD_RX - 127));
+}
+
+static int generate(const char *path, uint32_t frames, uint32_t baud)
+{
+    static uint8_t payload[TF_MAX_PAYLOAD_RX];
+    static TF_CaptureRing ring;
+    TF_CaptureRecord rec;
+    TF_Msg msg;
+    uint32_t i, j;
+
+    gen_file = fopen(path, "wb");
+    if (!gen_file) {
+        perror(path);
+        return 1;
+    }
+
+    gen_byte_ns = 10ull * 1000000000ull / baud; // 8N1，每字节 10 位
+    gen_tx.usertag = 0;
+    gen_rx.usertag = 1;
+    TF_InitStatic(&gen_tx, TF_MASTER);
+    TF_InitStatic(&gen_rx, TF_SLAVE);
+    TF_CaptureInit(&ring);
+    // 两端都抓包，生成的文件可以用 -d rx 或 -d tx 重放
+    TF_SetCapture(&gen_tx, &ring);
+    TF_SetCapture(&gen_rx, &ring);
+    TF_AddGenericListener(&gen_rx, countListener);
+    TF_CapFileWriteHeader(gen_file, 1, gen_now);
+
+    for (i = 0; i < frames; i++) {
+        TF_ClearMsg(&msg);
+        msg.type = (TF_TYPE) (gen_random() % 8);
+        msg.len = gen_payload_len();
+        for (j = 0; j < msg.len; j++) payload[j] = (uint8_t) gen_random();
+        msg.data = payload;
+        TF_Send(&gen_tx, &msg);
+
+        while (TF_CaptureRead(&ring, &rec)) TF_CapFileWriteFrame(gen_file, &rec);
+
+        // 帧之间的空闲时间
+        gen_now += (gen_random() % 64) * gen_byte_ns;
+    }
+
+    if (fclose(gen_file) != 0) {
+        perror(path);
+        return 1;
+    }
+    printf("已生成 %s：%u 帧，%u 波特\n", path, frames, baud);
+    return 0;
+}
+
+//endregion 生成
+
+//region 重放
+
+/** 按原始时间间隔等待到记录的时间 */
+static void wait_until(uint64_t start, uint64_t offset_ns)
+{
+    struct timespec ts;
+    uint64_t target = start + offset_ns;
+    ts.tv_sec = (time_t) (target / 1000000000ull);
+    ts.tv_nsec = (long) (target % 1000000000ull);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+static int replay(const char *path, uint32_t loops, bool timed, TF_CapRecordKind bytes_kind)
+{
+    TF_CapFileReader r;
+    TF_CapFileStatus st;
+    const TF_CapRecordHeader *rec;
+    const uint8_t *data;
+    struct stat sb;
+    void *map;
+    int fd;
+    uint32_t loop;
+    uint64_t bytes = 0, chunks = 0, recorded = 0, first_ts = 0, max_late = 0;
+    uint64_t t0, elapsed;
+    bool have_first = false;
+    TF_CapRecordKind frame_kind = (bytes_kind == TF_CAPREC_RX_BYTES) ? TF_CAPREC_RX_FRAME : TF_CAPREC_TX_FRAME;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        perror(path);
+        return 1;
+    }
+    if (sb.st_size < (off_t) sizeof(TF_CapFileHeader)) {
+        fprintf(stderr, "%s：不是有效的抓包文件\n", path);
+        close(fd);
+        return 1;
+    }
+    map = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    madvise(map, (size_t) sb.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    st = TF_CapFileOpen(&r, map, (size_t) sb.st_size);
+    if (st == TF_CAPFILE_FORMAT_MISMATCH) {
+        fprintf(stderr, "%s：帧格式（ID %u，LEN %u，TYPE %u，校验和 %u，SOF %u/0x%02x）与 TF_Config.h 不同\n",
+                path, r.header->id_bytes, r.header->len_bytes, r.header->type_bytes,
+                r.header->cksum_type, r.header->use_sof, r.header->sof_byte);
+        return 1;
+    }
+    if (st != TF_CAPFILE_OK) {
+        fprintf(stderr, "%s：不是有效的抓包文件（%d）\n", path, (int) st);
+        return 1;
+    }
+
+    // 第一遍：统计，同时把文件读入页缓存，使计时不包括磁盘读取
+    while (TF_CapFileNext(&r, &rec, &data)) {
+        if (rec->kind == bytes_kind) {
+            if (!have_first) {
+                first_ts = rec->timestamp;
+                have_first = true;
+            }
+            bytes += rec->size;
+            chunks++;
+        }
+        else if (rec->kind == frame_kind) {
+            recorded++;
+        }
+    }
+    if (chunks == 0) {
+        fprintf(stderr, "%s：没有要重放的字节记录\n", path);
+        return 1;
+    }
+
+    TF_InitStatic(&replay_tf, TF_MASTER);
+    TF_AddGenericListener(&replay_tf, countListener);
+
+    t0 = now_ns();
+    for (loop = 0; loop < loops; loop++) {
+        uint64_t loop_start = now_ns();
+        TF_CapFileRewind(&r);
+        while (TF_CapFileNext(&r, &rec, &data)) {
+            if (rec->kind != bytes_kind) continue;
+            if (timed) {
+                uint64_t offset = (rec->timestamp - first_ts) * r.header->time_unit_ns;
+                uint64_t late;
+                wait_until(loop_start, offset);
+                late = now_ns() - loop_start - offset;
+                if (late > max_late) max_late = late;
+            }
+            TF_Accept(&replay_tf, data, rec->size);
+        }
+    }
+    elapsed = now_ns() - t0;
+
+    printf("重放 %llu 字节（%llu 块）x %u 次，用时 %.3f s\n",
+           (unsigned long long) bytes, (unsigned long long) chunks, loops, elapsed / 1e9);
+    printf("  %.1f MB/s，%.2f ns/字节，%.0f 帧/s\n",
+           (double) bytes * loops / (elapsed / 1e9) / 1e6,
+           (double) elapsed / ((double) bytes * loops),
+           (double) frames_dispatched / (elapsed / 1e9));
+    printf("  帧：分发 %llu，录制 %llu x %u\n",
+           (unsigned long long) frames_dispatched, (unsigned long long) recorded, loops);
+    if (timed) printf("  最大延迟 %.1f us\n", max_late / 1e3);
+
+    munmap(map, (size_t) sb.st_size);
+    return 0;
+}
+
+//endregion 重放
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "用法: replay.bin [-t] [-n 次数] [-d rx|tx] 文件\n"
+            "      replay.bin -g 文件 [帧数] [波特率]\n"
+            "  -t  按原始时间间隔重放（默认尽可能快）\n"
+            "  -n  重复次数\n"
+            "  -d  重放接收的（默认）或发送的字节\n"
+            "  -g  生成合成的抓包文件\n");
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    bool timed = false;
+    uint32_t loops = 1;
+    TF_CapRecordKind kind = TF_CAPREC_RX_BYTES;
+    const char *gen_path = NULL;
+
+    while ((opt = getopt(argc, argv, "tn:d:g:")) != -1) {
+        switch (opt) {
+            case 't': timed = true; break;
+            case 'n': loops = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'd': kind = strcmp(optarg, "tx") == 0 ? TF_CAPREC_TX_BYTES : TF_CAPREC_RX_BYTES; break;
+            case 'g': gen_path = optarg; break;
+            default: usage(); return 2;
+        }
+    }
+
+    if (gen_path) {
+        uint32_t frames = optind < argc ? (uint32_t) strtoul(argv[optind], NULL, 0) : 10000;
+        uint32_t baud = optind + 1 < argc ? (uint32_t) strtoul(argv[optind + 1], NULL, 0) : 1000000;
+        if (baud == 0) baud = 1000000;
+        return generate(gen_path, frames, baud);
+    }
+
+    if (optind >= argc || loops == 0) {
+        usage();
+        return 2;
+    }
+    return replay(argv[optind], loops, timed, kind);
+}
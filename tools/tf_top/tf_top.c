@@ -0,0 +1,259 @@
+//
+// tf_top - 显示共享内存统计段中各实例的实时速率
+//
+// 应用用 utilities/tf_shmstats.h 把统计发布到段中，tf_top 只读地映射它，
+// 不访问应用进程本身。段的布局见 utilities/tf_shm_layout.h。
+//
+//   tf_top.bin [-i 间隔毫秒] [-n 次数] [-t 前 N 个] [段名称]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tf_shm_layout.h"
+
+#define LOAD(var) __atomic_load_n(&(var), __ATOMIC_RELAXED)
+
+/** 一个槽的快照 */
+struct snap {
+    uint64_t seq;
+    uint64_t updated_ns;
+    uint32_t pid;
+    char label[TF_SHM_LABEL_LEN];
+    uint32_t rx_frames, rx_bytes, tx_frames, tx_bytes;
+    uint32_t errors;        //!< 校验和错误、解析器超时、超长负载和丢弃的帧
+    uint32_t discarded, misses, expired;
+    uint32_t rx_queued, id_inflight, id_max;
+    uint32_t latency_count;
+    TF_ShmLatency latency[TF_SHM_LATENCY_TYPES];
+};
+
+/** 显示的一行 */
+struct row {
+    uint32_t slot;
+    struct snap s;
+    double rx_fps, rx_bps, tx_fps, tx_bps, err_ps, disc_bps, miss_ps;
+    bool stale;
+    bool dead;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+/** 读取一个槽，如果槽未使用则返回 false */
+static bool read_slot(const TF_ShmHeader *hdr, uint32_t i, struct snap *out)
+{
+    TF_ShmSlot *slot = TF_SHM_SLOT(hdr, i);
+    uint32_t k;
+
+    if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != TF_SHM_SLOT_ACTIVE) return false;
+
+    out->seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    out->updated_ns = LOAD(slot->updated_ns);
+    out->pid = LOAD(slot->pid);
+    memcpy(out->label, slot->label, TF_SHM_LABEL_LEN);
+    out->label[TF_SHM_LABEL_LEN - 1] = 0;
+
+    out->rx_frames = LOAD(slot->rx_frames);
+    out->rx_bytes = LOAD(slot->rx_bytes);
+    out->tx_frames = LOAD(slot->tx_frames);
+    out->tx_bytes = LOAD(slot->tx_bytes);
+    out->errors = LOAD(slot->head_cksum_errors) + LOAD(slot->body_cksum_errors) + LOAD(slot->parser_timeouts)
+                  + LOAD(slot->oversize_payloads) + LOAD(slot->rx_dropped);
+    out->discarded = LOAD(slot->rx_discarded_bytes);
+    out->misses = LOAD(slot->listener_misses);
+    out->expired = LOAD(slot->expired_listeners);
+    out->rx_queued = LOAD(slot->rx_queued);
+    out->id_inflight = LOAD(slot->id_listeners_inflight);
+    out->id_max = LOAD(slot->id_listeners_max);
+
+    out->latency_count = LOAD(slot->latency_count);
+    if (out->latency_count > TF_SHM_LATENCY_TYPES) out->latency_count = TF_SHM_LATENCY_TYPES;
+    for (k = 0; k < out->latency_count; k++) {
+        out->latency[k].type = LOAD(slot->latency[k].type);
+        out->latency[k].count = LOAD(slot->latency[k].count);
+        out->latency[k].timeouts = LOAD(slot->latency[k].timeouts);
+        out->latency[k].p50 = LOAD(slot->latency[k].p50);
+        out->latency[k].p99 = LOAD(slot->latency[k].p99);
+        out->latency[k].p999 = LOAD(slot->latency[k].p999);
+        out->latency[k].max = LOAD(slot->latency[k].max);
+    }
+    return true;
+}
+
+/** 按接收帧速率降序 */
+static int cmp_rows(const void *a, const void *b)
+{
+    const struct row *ra = a, *rb = b;
+    if (ra->rx_fps != rb->rx_fps) return ra->rx_fps < rb->rx_fps ? 1 : -1;
+    return (int) ra->slot - (int) rb->slot;
+}
+
+/** 延迟的显示（微秒，单位未知时为原始值） */
+static void format_latency(char *buf, size_t n, const TF_ShmHeader *hdr, const struct snap *s)
+{
+    const TF_ShmLatency *l;
+    double v;
+
+    if (s->latency_count == 0) {
+        snprintf(buf, n, "-");
+        return;
+    }
+    // 显示查询最多的类型
+    l = &s->latency[0];
+    for (uint32_t k = 1; k < s->latency_count; k++) {
+        if (s->latency[k].count > l->count) l = &s->latency[k];
+    }
+    if (hdr->time_unit_ns) {
+        v = (double) l->p99 * hdr->time_unit_ns / 1e3;
+        snprintf(buf, n, "%u:%.0fus", l->type, v);
+    } else {
+        snprintf(buf, n, "%u:%llu", l->type, (unsigned long long) l->p99);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "用法: tf_top.bin [-i 间隔毫秒] [-n 次数] [-t 前 N 个] [段名称]\n"
+            "  -i  刷新间隔（默认 1000 毫秒）\n"
+            "  -n  刷新次数后退出（默认一直运行）\n"
+            "  -t  只显示接收速率最高的 N 个实例\n"
+            "  段名称默认为 /tinyframe\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = "/tinyframe";
+    uint32_t interval_ms = 1000, iterations = 0, top = 0;
+    uint32_t iter, i, nrows;
+    int opt, fd;
+    struct stat sb;
+    TF_ShmHeader *hdr;
+    struct snap *prev;
+    bool *have_prev;
+    struct row *rows;
+    bool tty = isatty(STDOUT_FILENO);
+
+    while ((opt = getopt(argc, argv, "i:n:t:")) != -1) {
+        switch (opt) {
+            case 'i': interval_ms = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'n': iterations = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 't': top = (uint32_t) strtoul(optarg, NULL, 0); break;
+            default: usage(); return 2;
+        }
+    }
+    if (optind < argc) name = argv[optind];
+    if (interval_ms == 0) interval_ms = 1000;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        perror(name);
+        return 1;
+    }
+    if ((size_t) sb.st_size < sizeof(TF_ShmHeader)) {
+        fprintf(stderr, "%s：段尚未初始化\n", name);
+        return 1;
+    }
+    hdr = mmap(NULL, (size_t) sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != TF_SHM_MAGIC || hdr->version != TF_SHM_VERSION ||
+        hdr->header_size != sizeof(TF_ShmHeader) || hdr->slot_size != sizeof(TF_ShmSlot) ||
+        (size_t) sb.st_size < TF_SHM_SIZE(hdr->capacity)) {
+        fprintf(stderr, "%s：布局不兼容（版本 %u，需要 %u）\n", name, hdr->version, TF_SHM_VERSION);
+        return 1;
+    }
+
+    prev = calloc(hdr->capacity, sizeof(struct snap));
+    have_prev = calloc(hdr->capacity, sizeof(bool));
+    rows = calloc(hdr->capacity, sizeof(struct row));
+    if (!prev || !have_prev || !rows) {
+        fprintf(stderr, "内存不足\n");
+        return 1;
+    }
+
+    for (iter = 0; iterations == 0 || iter < iterations; iter++) {
+        uint64_t now = now_ns();
+        double tot_rx = 0, tot_tx = 0, tot_err = 0;
+        uint32_t show;
+        char lat[32];
+
+        nrows = 0;
+        for (i = 0; i < hdr->capacity; i++) {
+            struct row *r = &rows[nrows];
+            double dt;
+
+            if (!read_slot(hdr, i, &r->s)) {
+                have_prev[i] = false;
+                continue;
+            }
+            r->slot = i;
+            r->rx_fps = r->rx_bps = r->tx_fps = r->tx_bps = r->err_ps = r->disc_bps = r->miss_ps = 0;
+
+            // 速率基于发布者的时间戳，不受 tf_top 的采样时刻影响
+            if (have_prev[i] && r->s.updated_ns > prev[i].updated_ns) {
+                dt = (double) (r->s.updated_ns - prev[i].updated_ns) / 1e9;
+                r->rx_fps = (uint32_t) (r->s.rx_frames - prev[i].rx_frames) / dt;
+                r->rx_bps = (uint32_t) (r->s.rx_bytes - prev[i].rx_bytes) / dt;
+                r->tx_fps = (uint32_t) (r->s.tx_frames - prev[i].tx_frames) / dt;
+                r->tx_bps = (uint32_t) (r->s.tx_bytes - prev[i].tx_bytes) / dt;
+                r->err_ps = (uint32_t) (r->s.errors - prev[i].errors) / dt;
+                r->disc_bps = (uint32_t) (r->s.discarded - prev[i].discarded) / dt;
+                r->miss_ps = (uint32_t) (r->s.misses - prev[i].misses) / dt;
+            }
+            if (!have_prev[i] || r->s.updated_ns != prev[i].updated_ns) {
+                prev[i] = r->s;
+                have_prev[i] = true;
+            }
+
+            r->stale = r->s.seq == 0 || now - r->s.updated_ns > 3ull * interval_ms * 1000000ull;
+            r->dead = kill((pid_t) r->s.pid, 0) != 0 && errno == ESRCH;
+
+            tot_rx += r->rx_fps;
+            tot_tx += r->tx_fps;
+            tot_err += r->err_ps;
+            nrows++;
+        }
+
+        if (top) qsort(rows, nrows, sizeof(struct row), cmp_rows);
+        show = (top && top < nrows) ? top : nrows;
+
+        if (tty) printf("\033[H\033[2J");
+        printf("%s：%u/%u 个实例，接收 %.0f 帧/s，发送 %.0f 帧/s，错误 %.1f/s\n",
+               name, nrows, hdr->capacity, tot_rx, tot_tx, tot_err);
+        printf("%5s %-16s %7s %9s %9s %9s %9s %7s %8s %6s %6s %7s %s\n",
+               "SLOT", "LABEL", "PID", "RX f/s", "RX B/s", "TX f/s", "TX B/s", "ERR/s", "NOISE/s",
+               "MISS/s", "QUEUE", "ID", "p99");
+        for (i = 0; i < show; i++) {
+            struct row *r = &rows[i];
+            char idbuf[16];
+            format_latency(lat, sizeof(lat), hdr, &r->s);
+            snprintf(idbuf, sizeof(idbuf), "%u/%u", r->s.id_inflight, r->s.id_max);
+            printf("%5u %-16.16s %7u %9.0f %9.0f %9.0f %9.0f %7.1f %8.0f %6.1f %6u %7s %s%s\n",
+                   r->slot, r->s.label, r->s.pid, r->rx_fps, r->rx_bps, r->tx_fps, r->tx_bps, r->err_ps,
+                   r->disc_bps, r->miss_ps, r->s.rx_queued, idbuf, lat,
+                   r->dead ? " (已退出)" : (r->stale ? " (未更新)" : ""));
+        }
+        fflush(stdout);
+
+        if (iterations == 0 || iter + 1 < iterations) usleep(interval_ms * 1000);
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "query_sync.h"
+
+#if !TF_USE_MUTEX || !TF_USE_REGISTRY_LOCK
+    #error TF_QuerySync 需要 TF_USE_MUTEX 和 TF_USE_REGISTRY_LOCK
+#endif
+
+enum qs_state {
+    QS_FREE = 0,   //!< 槽空闲
+    QS_WAITING,    //!< 等待响应
+    QS_DONE,       //!< 已收到响应
+};
+
+/**
+ * 等待槽。
+ *
+ * 槽从不释放，只被重用：调用者超时后，监听器可能仍在接收线程中运行，
+ * 因此监听器只通过代数（generation，作为 userdata2 传递）确认槽仍属于它的查询。
+ */
+struct qs_waiter {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t gen;
+    enum qs_state state;
+    TF_Msg resp;
+};
+
+static struct qs_waiter qs_waiters[TF_QUERY_SYNC_WAITERS];
+static pthread_mutex_t qs_alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t qs_once = PTHREAD_ONCE_INIT;
+
+static void qs_init(void)
+{
+    uint32_t i;
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    for (i = 0; i < TF_QUERY_SYNC_WAITERS; i++) {
+        pthread_mutex_init(&qs_waiters[i].lock, NULL);
+        pthread_cond_init(&qs_waiters[i].cond, &attr);
+    }
+    pthread_condattr_destroy(&attr);
+}
+
+/** 占用一个空闲槽，返回时持有槽的锁 */
+static struct qs_waiter *qs_acquire(void)
+{
+    uint32_t i;
+    struct qs_waiter *w;
+
+    pthread_mutex_lock(&qs_alloc_lock);
+    for (i = 0; i < TF_QUERY_SYNC_WAITERS; i++) {
+        w = &qs_waiters[i];
+        pthread_mutex_lock(&w->lock);
+        if (w->state == QS_FREE) {
+            w->gen++;
+            w->state = QS_WAITING;
+            pthread_mutex_unlock(&qs_alloc_lock);
+            return w;
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+    pthread_mutex_unlock(&qs_alloc_lock);
+    return NULL;
+}
+
+/** 将负载交给等待者：在池模式下接管接收缓冲区，否则复制 */
+static const uint8_t *qs_take_payload(TinyFrame *tf, TF_Msg *msg)
+{
+    // 空响应没有负载，TF_QuerySyncRelease() 也就不需要归还或释放任何东西
+    if (msg->len == 0) return NULL;
+
+#if TF_USE_RX_POOL
+    return TF_TakePayload(tf, msg);
+#else
+    uint8_t *copy;
+
+    (void) tf;
+    copy = malloc(msg->len);
+    if (copy == NULL) return NULL;
+    memcpy(copy, msg->data, msg->len);
+    return copy;
+#endif
+}
+
+/**
+ * 查询的 ID 监听器。
+ *
+ * 只有交付了响应时才返回 TF_CLOSE。调用者已放弃时返回 TF_STAY，监听器留给调用者移除，
+ * 这样调用者的 TF_RemoveIdListener() 总能找到它，不会误报 TF_ERR_LISTENER_NOT_FOUND。
+ */
+static TF_Result qs_listener(TinyFrame *tf, TF_Msg *msg)
+{
+    struct qs_waiter *w = msg->userdata;
+    TF_Result rv = TF_STAY;
+
+    pthread_mutex_lock(&w->lock);
+    // data == NULL 是监听器被移除的通知；代数不同表示调用者已放弃并且槽可能已被重用
+    if (msg->data != NULL && w->state == QS_WAITING && w->gen == (uint32_t) (uintptr_t) msg->userdata2) {
+        w->resp = *msg;
+        w->resp.userdata = NULL;
+        w->resp.userdata2 = NULL;
+        w->resp.data = qs_take_payload(tf, msg);
+        if (w->resp.data == NULL && msg->len != 0) {
+            TF_Error("同步查询：无法保存响应");
+            w->resp.len = 0;
+        }
+        w->state = QS_DONE;
+        pthread_cond_signal(&w->cond);
+        rv = TF_CLOSE;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return rv;
+}
+
+bool TF_QuerySync(TinyFrame *tf, TF_Msg *msg, uint32_t timeout_ms, TF_Msg *out_response)
+{
+    struct qs_waiter *w;
+    struct timespec deadline;
+    uint32_t gen;
+    bool ok;
+    int rv = 0;
+
+    pthread_once(&qs_once, qs_init);
+
+    w = qs_acquire();
+    if (w == NULL) {
+        TF_Error("同步查询：没有空闲的等待槽");
+        return false;
+    }
+    gen = w->gen;
+    pthread_mutex_unlock(&w->lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    // 不带 tick 超时注册监听器，截止时间由这里的时钟决定。
+    // 响应可能在 TF_Query() 返回之前到达（在接收线程中，或在回环链路上在本线程中）。
+    msg->userdata = w;
+    msg->userdata2 = (void *) (uintptr_t) gen;
+    if (!TF_Query(tf, msg, qs_listener, NULL, 0)) {
+        pthread_mutex_lock(&w->lock);
+        w->state = QS_FREE;
+        pthread_mutex_unlock(&w->lock);
+        return false;
+    }
+
+    pthread_mutex_lock(&w->lock);
+    while (w->state == QS_WAITING && rv != ETIMEDOUT) {
+        rv = pthread_cond_timedwait(&w->cond, &w->lock, &deadline);
+    }
+
+    ok = (w->state == QS_DONE);
+    if (ok) {
+        *out_response = w->resp;
+    }
+    // 释放槽；之后仍在运行的监听器会发现代数已不匹配
+    w->state = QS_FREE;
+    pthread_mutex_unlock(&w->lock);
+
+    // 没有交付响应时监听器从不自行关闭（见 qs_listener()），因此仍在表中
+    if (!ok) {
+        TF_RemoveIdListener(tf, msg->frame_id);
+    }
+    return ok;
+}
+
+void TF_QuerySyncRelease(TinyFrame *tf, TF_Msg *response)
+{
+#if TF_USE_RX_POOL
+    TF_ReleasePayload(tf, response->data);
+#else
+    (void) tf;
+    free((void *) response->data);
+#endif
+    response->data = NULL;
+    response->len = 0;
+}
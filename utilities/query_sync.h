@@ -0,0 +1,45 @@
+#ifndef QUERY_SYNC_H
+#define QUERY_SYNC_H
+
+/**
+ * 同步查询，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 发送查询并阻塞调用线程，直到收到响应或单调时钟上的截止时间到期。
+ * 另一个线程必须继续调用 TF_Accept()（以及 TF_Dispatch()，如果使用接收队列），
+ * 因此需要 TF_USE_MUTEX 和 TF_USE_REGISTRY_LOCK，并使用 POSIX 线程。
+ *
+ * 响应缓冲区交给调用者：在 TF_USE_RX_POOL 模式下直接接管接收缓冲区（不复制），
+ * 否则复制到 malloc() 分配的缓冲区。用完后必须调用 TF_QuerySyncRelease()。
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "TinyFrame.h"
+
+#ifndef TF_QUERY_SYNC_WAITERS
+/** 可以同时等待的同步查询数量 */
+#define TF_QUERY_SYNC_WAITERS 8
+#endif
+
+/**
+ * 发送查询并等待响应。
+ *
+ * @param tf - 实例
+ * @param msg - 要发送的消息（userdata 字段被忽略；返回后 frame_id 为使用的 ID）
+ * @param timeout_ms - 等待响应的最长时间（毫秒）
+ * @param out_response - 输出，收到的响应；data 必须用 TF_QuerySyncRelease() 释放
+ * @return 收到响应时返回 true；超时、发送失败或没有空闲的等待槽时返回 false
+ */
+bool TF_QuerySync(TinyFrame *tf, TF_Msg *msg, uint32_t timeout_ms, TF_Msg *out_response);
+
+/**
+ * 释放 TF_QuerySync() 返回的响应缓冲区。
+ *
+ * @param tf - 实例
+ * @param response - TF_QuerySync() 填充的响应
+ */
+void TF_QuerySyncRelease(TinyFrame *tf, TF_Msg *response);
+
+#endif // QUERY_SYNC_H
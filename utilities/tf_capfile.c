@@ -0,0 +1,145 @@
+#include <string.h>
+#include "tf_capfile.h"
+
+_Static_assert(sizeof(TF_CapFileHeader) == 32, "TF_CapFileHeader 的大小是文件格式的一部分");
+_Static_assert(sizeof(TF_CapRecordHeader) == 16, "TF_CapRecordHeader 的大小是文件格式的一部分");
+_Static_assert(sizeof(TF_CapFrame) == 12, "TF_CapFrame 的大小是文件格式的一部分");
+
+/** 数据后面的填充字节数 */
+static inline size_t capfile_padding(size_t size)
+{
+    return (TF_CAPFILE_ALIGN - (size % TF_CAPFILE_ALIGN)) % TF_CAPFILE_ALIGN;
+}
+
+/** 写入填充 */
+static bool capfile_pad(FILE *f, size_t size)
+{
+    static const uint8_t zeros[TF_CAPFILE_ALIGN] = {0};
+    size_t pad = capfile_padding(size);
+    return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+/** 用当前的配置填写文件头的格式字段 */
+static void capfile_fill_format(TF_CapFileHeader *h)
+{
+    h->id_bytes = TF_ID_BYTES;
+    h->len_bytes = TF_LEN_BYTES;
+    h->type_bytes = TF_TYPE_BYTES;
+    h->cksum_type = TF_CKSUM_TYPE;
+#if TF_USE_SOF_BYTE
+    h->use_sof = 1;
+    h->sof_byte = TF_SOF_BYTE;
+#else
+    h->use_sof = 0;
+    h->sof_byte = 0;
+#endif
+}
+
+//region 写入
+
+bool TF_CapFileWriteHeader(FILE *f, uint32_t time_unit_ns, uint64_t start_time)
+{
+    TF_CapFileHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TF_CAPFILE_MAGIC;
+    h.version = TF_CAPFILE_VERSION;
+    capfile_fill_format(&h);
+    h.time_unit_ns = time_unit_ns;
+    h.start_time = start_time;
+    return fwrite(&h, sizeof(h), 1, f) == 1;
+}
+
+/** 写入记录头 */
+static bool capfile_record(FILE *f, TF_CapRecordKind kind, uint32_t usertag, uint64_t timestamp, uint32_t size)
+{
+    TF_CapRecordHeader rh;
+    rh.timestamp = timestamp;
+    rh.size = size;
+    rh.kind = (uint8_t) kind;
+    rh.reserved = 0;
+    rh.usertag = (uint16_t) usertag;
+    return fwrite(&rh, sizeof(rh), 1, f) == 1;
+}
+
+bool TF_CapFileWriteBytes(FILE *f, TF_CapRecordKind kind, uint32_t usertag, uint64_t timestamp,
+                          const uint8_t *data, uint32_t len)
+{
+    if (!capfile_record(f, kind, usertag, timestamp, len)) return false;
+    if (len > 0 && fwrite(data, 1, len, f) != len) return false;
+    return capfile_pad(f, len);
+}
+
+#if TF_USE_CAPTURE
+bool TF_CapFileWriteFrame(FILE *f, const TF_CaptureRecord *rec)
+{
+    TF_CapFrame fr;
+    uint32_t size = (uint32_t) sizeof(fr) + rec->caplen;
+
+    fr.id = rec->id;
+    fr.type = rec->type;
+    fr.len = rec->len;
+
+    if (!capfile_record(f, rec->dir == TF_CAPTURE_TX ? TF_CAPREC_TX_FRAME : TF_CAPREC_RX_FRAME,
+                        rec->usertag, rec->timestamp, size)) return false;
+    if (fwrite(&fr, sizeof(fr), 1, f) != 1) return false;
+    if (rec->caplen > 0 && fwrite(rec->data, 1, rec->caplen, f) != rec->caplen) return false;
+    return capfile_pad(f, size);
+}
+#endif
+
+//endregion 写入
+
+//region 读取
+
+TF_CapFileStatus TF_CapFileOpen(TF_CapFileReader *r, const void *data, size_t size)
+{
+    const TF_CapFileHeader *h = data;
+    TF_CapFileHeader expected;
+
+    r->base = data;
+    r->size = size;
+    r->pos = sizeof(TF_CapFileHeader);
+    r->header = h;
+
+    if (size < sizeof(TF_CapFileHeader)) {
+        r->pos = size;
+        r->header = NULL;
+        return TF_CAPFILE_TRUNCATED;
+    }
+    if (h->magic != TF_CAPFILE_MAGIC) return TF_CAPFILE_BAD_MAGIC;
+    if (h->version != TF_CAPFILE_VERSION) return TF_CAPFILE_BAD_VERSION;
+
+    capfile_fill_format(&expected);
+    if (h->id_bytes != expected.id_bytes || h->len_bytes != expected.len_bytes ||
+        h->type_bytes != expected.type_bytes || h->cksum_type != expected.cksum_type ||
+        h->use_sof != expected.use_sof || h->sof_byte != expected.sof_byte) {
+        return TF_CAPFILE_FORMAT_MISMATCH;
+    }
+    return TF_CAPFILE_OK;
+}
+
+bool TF_CapFileNext(TF_CapFileReader *r, const TF_CapRecordHeader **rec, const uint8_t **data)
+{
+    const TF_CapRecordHeader *rh;
+    size_t avail = r->size - r->pos;
+
+    if (avail < sizeof(TF_CapRecordHeader)) return false;
+    rh = (const TF_CapRecordHeader *) (r->base + r->pos);
+    if (rh->size > avail - sizeof(TF_CapRecordHeader)) return false;
+
+    *rec = rh;
+    *data = r->base + r->pos + sizeof(TF_CapRecordHeader);
+
+    // 最后一条记录后面的填充可以省略
+    r->pos += sizeof(TF_CapRecordHeader) + rh->size;
+    r->pos += capfile_padding(rh->size);
+    if (r->pos > r->size) r->pos = r->size;
+    return true;
+}
+
+void TF_CapFileRewind(TF_CapFileReader *r)
+{
+    r->pos = r->header ? sizeof(TF_CapFileHeader) : r->size;
+}
+
+//endregion 读取
@@ -0,0 +1,164 @@
+#ifndef TF_CAPFILE_H
+#define TF_CAPFILE_H
+
+/**
+ * 抓包文件，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 紧凑的磁盘格式，保存原始字节流（传给 TF_Accept() 或 TF_WriteImpl() 的块）和帧边界
+ * （从 TF_CaptureRing 读出的记录），用于离线重现生产环境中的性能问题，以及用真实的流量
+ * 对解析器的修改做基准测试（见 tools/replay）。
+ *
+ * 文件由一个文件头和一串记录组成。每条记录有 16 字节的记录头，数据填充到 8 字节边界，
+ * 因此文件可以直接 mmap() 并原地读取，不需要复制。数值使用写入方的本机字节序，读取时
+ * 用文件头中的魔数检查。
+ *
+ *     FILE *f = fopen("link.tfcap", "wb");
+ *     TF_CapFileWriteHeader(f, 1, 0);
+ *     ...
+ *     TF_CapFileWriteBytes(f, TF_CAPREC_RX_BYTES, 0, now_ns(), buf, n); // 在调用 TF_Accept() 的地方
+ *     TF_Accept(tf, buf, n);
+ *     ...
+ *     while (TF_CaptureRead(&ring, &rec)) TF_CapFileWriteFrame(f, &rec);
+ *
+ * 写入函数使用 stdio 的缓冲，不是线程安全的：多个线程写入同一个文件时由调用者加锁。
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "TinyFrame.h"
+
+/** 文件头中的魔数（小端序机器上为 "TFCP"） */
+#define TF_CAPFILE_MAGIC 0x50434654u
+/** 格式版本 */
+#define TF_CAPFILE_VERSION 1
+
+/** 文件头 */
+typedef struct TF_CapFileHeader_ {
+    uint32_t magic;         //!< TF_CAPFILE_MAGIC
+    uint16_t version;       //!< TF_CAPFILE_VERSION
+    uint8_t id_bytes;       //!< 录制时的 TF_ID_BYTES
+    uint8_t len_bytes;      //!< TF_LEN_BYTES
+    uint8_t type_bytes;     //!< TF_TYPE_BYTES
+    uint8_t cksum_type;     //!< TF_CKSUM_TYPE
+    uint8_t use_sof;        //!< TF_USE_SOF_BYTE
+    uint8_t sof_byte;       //!< TF_SOF_BYTE（不使用时为 0）
+    uint32_t time_unit_ns;  //!< 时间戳的单位（纳秒），1 表示纳秒
+    uint64_t start_time;    //!< 录制开始的时间戳（仅供参考）
+    uint64_t reserved;
+} TF_CapFileHeader;
+
+/** 记录类型 */
+typedef enum {
+    TF_CAPREC_RX_BYTES = 1, //!< 接收的原始字节（一次 TF_Accept() 的输入）
+    TF_CAPREC_TX_BYTES = 2, //!< 发送的原始字节（一次 TF_WriteImpl() 的输出）
+    TF_CAPREC_RX_FRAME = 3, //!< 接收的帧的边界（TF_CapFrame + 负载的前 caplen 字节）
+    TF_CAPREC_TX_FRAME = 4, //!< 发送的帧的边界
+} TF_CapRecordKind;
+
+/** 记录头，后面是 size 字节的数据和填充到 8 字节边界的零 */
+typedef struct TF_CapRecordHeader_ {
+    uint64_t timestamp;     //!< 时间戳，单位见文件头
+    uint32_t size;          //!< 数据的字节数（不含填充）
+    uint8_t kind;           //!< TF_CapRecordKind
+    uint8_t reserved;
+    uint16_t usertag;       //!< 实例的 usertag 的低 16 位
+} TF_CapRecordHeader;
+
+/** 帧记录的数据开头，后面是负载的前 (size - sizeof(TF_CapFrame)) 字节 */
+typedef struct TF_CapFrame_ {
+    uint32_t id;
+    uint32_t type;
+    uint32_t len;           //!< 负载的实际长度
+} TF_CapFrame;
+
+/** 记录的数据按此对齐 */
+#define TF_CAPFILE_ALIGN 8
+
+// ---------------------------------- 写入 ----------------------------------
+
+/**
+ * 写入文件头，格式字段取自当前的配置（TF_Config.h）
+ *
+ * @param f - 输出文件（以二进制模式打开）
+ * @param time_unit_ns - 时间戳的单位（纳秒）
+ * @param start_time - 录制开始的时间戳
+ * @return 成功时返回 true
+ */
+bool TF_CapFileWriteHeader(FILE *f, uint32_t time_unit_ns, uint64_t start_time);
+
+/**
+ * 写入一块原始字节
+ *
+ * @param f - 输出文件
+ * @param kind - TF_CAPREC_RX_BYTES 或 TF_CAPREC_TX_BYTES
+ * @param usertag - 实例的 usertag
+ * @param timestamp - 时间戳
+ * @param data - 字节
+ * @param len - 字节数
+ * @return 成功时返回 true
+ */
+bool TF_CapFileWriteBytes(FILE *f, TF_CapRecordKind kind, uint32_t usertag, uint64_t timestamp,
+                          const uint8_t *data, uint32_t len);
+
+#if TF_USE_CAPTURE
+/**
+ * 写入从抓包环读出的一条帧记录
+ *
+ * @param f - 输出文件
+ * @param rec - 记录
+ * @return 成功时返回 true
+ */
+bool TF_CapFileWriteFrame(FILE *f, const TF_CaptureRecord *rec);
+#endif
+
+// ---------------------------------- 读取 ----------------------------------
+
+/** 读取器，遍历内存中的（通常是 mmap() 映射的）整个文件 */
+typedef struct TF_CapFileReader_ {
+    const uint8_t *base;
+    size_t size;
+    size_t pos;
+    const TF_CapFileHeader *header;
+} TF_CapFileReader;
+
+/** TF_CapFileOpen() 的结果 */
+typedef enum {
+    TF_CAPFILE_OK = 0,
+    TF_CAPFILE_TRUNCATED,   //!< 文件比文件头短
+    TF_CAPFILE_BAD_MAGIC,   //!< 不是抓包文件，或字节序不同
+    TF_CAPFILE_BAD_VERSION, //!< 不支持的版本
+    TF_CAPFILE_FORMAT_MISMATCH, //!< 帧格式与当前的配置不同，无法用 TF_Accept() 重放
+} TF_CapFileStatus;
+
+/**
+ * 开始读取内存中的文件
+ *
+ * @param r - 读取器
+ * @param data - 文件内容，必须按 8 字节对齐（mmap() 的结果总是对齐的）
+ * @param size - 文件大小
+ * @return TF_CAPFILE_OK，或者错误；格式不同时读取器仍然可用，只是不能重放
+ */
+TF_CapFileStatus TF_CapFileOpen(TF_CapFileReader *r, const void *data, size_t size);
+
+/**
+ * 读取下一条记录。数据指向文件内部，不复制。
+ *
+ * @param r - 读取器
+ * @param rec - 输出，记录头
+ * @param data - 输出，记录的数据
+ * @return 读取了一条记录时返回 true；文件结束（或最后一条记录不完整）时返回 false
+ */
+bool TF_CapFileNext(TF_CapFileReader *r, const TF_CapRecordHeader **rec, const uint8_t **data);
+
+/**
+ * 回到第一条记录
+ *
+ * @param r - 读取器
+ */
+void TF_CapFileRewind(TF_CapFileReader *r);
+
+#endif // TF_CAPFILE_H
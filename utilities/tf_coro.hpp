@@ -0,0 +1,174 @@
+#ifndef TF_CORO_HPP
+#define TF_CORO_HPP
+
+/**
+ * C++20 协程查询，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 将 TF_Query() 包装为可等待对象，使多步交换可以写成顺序代码：
+ *
+ *     tf::Detached provision(TinyFrame *tf)
+ *     {
+ *         auto r = co_await tf::query_simple(tf, CMD_HELLO, nullptr, 0, 10);
+ *         if (!r) co_return; // 超时
+ *         r = co_await tf::query_simple(tf, CMD_CONFIG, cfg, sizeof(cfg), 10);
+ *         ...
+ *     }
+ *
+ * 等待对象位于协程帧中并作为 ID 监听器的 userdata 传递，因此每次查询不会额外分配内存。
+ * 协程在运行监听器的线程中恢复：收到响应时在 TF_Accept()（或 TF_Dispatch()）中，
+ * 超时时在 TF_Tick() 中。因此一个事件循环线程可以同时推进许多设备的查询序列。
+ * 监听器也可以在另一个线程中运行（例如接收线程调用 TF_Accept() 而协程在发送线程中发起查询）：
+ * 发起查询和监听器之间通过原子状态交接，恰好由一方继续执行协程。
+ *
+ * 响应的 data 指向接收缓冲区，只在协程下一次挂起之前有效；需要保留时请复制
+ * （或在 TF_USE_RX_POOL 模式下使用 TF_TakePayload()）。
+ */
+
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <thread>
+#include "TinyFrame.h"
+
+namespace tf {
+
+/** 查询结果状态 */
+enum class QueryStatus {
+    Ok,          //!< 收到响应
+    Timeout,     //!< 监听器超时（或被 TF_RemoveIdListener() 移除）
+    SendFailed,  //!< 无法发送帧或注册 ID 监听器
+};
+
+/** co_await 查询的结果 */
+struct QueryResult {
+    QueryStatus status;
+    TF_Msg msg; //!< 响应（status == Ok 时有效）
+
+    explicit operator bool() const noexcept { return status == QueryStatus::Ok; }
+};
+
+/** 查询的可等待对象，由 tf::query() 创建 */
+class QueryAwaiter {
+public:
+    QueryAwaiter(TinyFrame *tf, const TF_Msg &msg, TF_TICKS timeout) noexcept
+        : tf_(tf), timeout_(timeout)
+    {
+        result_.status = QueryStatus::SendFailed;
+        result_.msg = msg;
+    }
+
+    QueryAwaiter(const QueryAwaiter &) = delete;
+    QueryAwaiter &operator=(const QueryAwaiter &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        TF_Msg msg = result_.msg;
+
+        handle_ = handle;
+        sender_ = std::this_thread::get_id();
+        msg.userdata = this;
+        msg.userdata2 = nullptr;
+
+        state_.store(State::Sending, std::memory_order_relaxed);
+        if (!TF_Query(tf_, &msg, &QueryAwaiter::on_message, nullptr, timeout_)) {
+            result_.status = QueryStatus::SendFailed;
+            return false;
+        }
+
+        // 在回环或同步链路上，响应可能在 TF_Query() 返回之前在本线程中到达。
+        // 此时监听器不恢复协程，而是在这里直接继续执行（不挂起）。
+        // 切换到 Suspended 之后协程可能已在另一个线程中恢复，不能再访问 this。
+        State expected = State::Sending;
+        return state_.compare_exchange_strong(expected, State::Suspended,
+                                              std::memory_order_release, std::memory_order_acquire);
+    }
+
+    QueryResult await_resume() const noexcept { return result_; }
+
+private:
+    static TF_Result on_message(TinyFrame *tf, TF_Msg *msg)
+    {
+        (void) tf;
+        auto *self = static_cast<QueryAwaiter *>(msg->userdata);
+
+        // data == NULL 表示监听器已超时或被移除（参见 TF_Msg::data）
+        self->result_.status = (msg->data != nullptr) ? QueryStatus::Ok : QueryStatus::Timeout;
+        self->result_.msg = *msg;
+        self->result_.msg.userdata = nullptr;
+
+        // 恢复后协程可能已结束，此后不能再访问 self
+        std::coroutine_handle<> handle = self->handle_;
+        if (self->sender_ == std::this_thread::get_id()) {
+            // 仍在 TF_Query() 中：await_suspend() 看到 Done 后直接继续
+            if (self->state_.exchange(State::Done, std::memory_order_acq_rel) != State::Suspended) {
+                return TF_CLOSE;
+            }
+        } else {
+            // 另一个线程：等待发起查询的线程挂起协程，然后在这里恢复，使 data 在协程中有效
+            while (self->state_.load(std::memory_order_acquire) == State::Sending) {
+                std::this_thread::yield();
+            }
+        }
+        handle.resume();
+        return TF_CLOSE;
+    }
+
+    /** 发起查询的一方与监听器之间的交接 */
+    enum class State : uint8_t {
+        Sending,    //!< TF_Query() 尚未返回，监听器不恢复协程
+        Suspended,  //!< 协程已挂起，由监听器恢复
+        Done,       //!< 监听器已在 TF_Query() 中运行
+    };
+
+    TinyFrame *tf_;
+    TF_TICKS timeout_;
+    QueryResult result_;
+    std::coroutine_handle<> handle_;
+    std::thread::id sender_;    //!< 发起查询的线程
+    std::atomic<State> state_{State::Sending};
+};
+
+/**
+ * 发送查询并等待响应。
+ *
+ * @param tf - 实例
+ * @param msg - 要发送的消息（userdata 字段被忽略）
+ * @param timeout - 超时时间（以 tick 为单位）；0 = 无超时
+ */
+inline QueryAwaiter query(TinyFrame *tf, const TF_Msg &msg, TF_TICKS timeout)
+{
+    return QueryAwaiter(tf, msg, timeout);
+}
+
+/** 与 query() 相同，但使用类型和负载 */
+inline QueryAwaiter query_simple(TinyFrame *tf, TF_TYPE type, const uint8_t *data, TF_LEN len, TF_TICKS timeout)
+{
+    TF_Msg msg;
+    TF_ClearMsg(&msg);
+    msg.type = type;
+    msg.data = data;
+    msg.len = len;
+    return QueryAwaiter(tf, msg, timeout);
+}
+
+/**
+ * 最简单的“启动后不管”协程类型，立即开始运行，结束时自行销毁。
+ * 已有自己的任务类型的项目不需要使用它。
+ */
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace tf
+
+#endif // TF_CORO_HPP
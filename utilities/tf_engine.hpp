@@ -0,0 +1,856 @@
+#ifndef TF_ENGINE_HPP
+#define TF_ENGINE_HPP
+
+/**
+ * 编译期特化的帧引擎，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * tf::Engine<IdT, LenT, TypeT, Checksum, RxCap, TxCap, Options> 实现与 TinyFrame.c 相同的线路格式和
+ * 监听器语义，但所有字段宽度、校验和和缓冲区大小都是模板参数，而不是 TF_Config.h 中的全局宏。
+ * 因此一个程序可以同时使用多种配置（例如网关桥接不同的设备系列），每个特化都在编译期完全展开。
+ *
+ *     using DeviceA = tf::Engine<uint8_t, uint16_t, uint8_t, tf::checksum::Crc16, 1024, 128>;
+ *     using DeviceB = tf::Engine<uint16_t, uint32_t, uint16_t, tf::checksum::Crc32, 4096, 512>;
+ *
+ * 与 C 版本的区别：
+ * - 不依赖 TinyFrame.h / TF_Config.h，可以与 C 库在同一程序中使用；
+ * - 输出函数和 userdata 在构造时传入，而不是 extern 的 TF_WriteImpl()；
+ * - 没有内部锁，同一实例只能由一个线程使用（或由调用者串行化）。
+ *
+ * 不依赖 TinyFrame.h，因此没有命名为 TinyFrame（那是 C 结构体的类型名）。
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+namespace tf {
+
+/** 监听器的响应，与 TF_Result 相同 */
+enum class Result {
+    Next = 0,   //!< 未处理，让其他监听器处理
+    Stay = 1,   //!< 已处理，保持
+    Renew = 2,  //!< 已处理，保持，续期 - 仅在监听器超时时有用
+    Close = 3,  //!< 已处理，移除自身
+};
+
+/** 对方位，与 TF_Peer 相同 */
+enum class Peer {
+    Slave = 0,
+    Master = 1,
+};
+
+namespace checksum {
+
+namespace detail {
+    /** 生成反射多项式的 CRC 查找表 */
+    template <class T, T Poly>
+    constexpr std::array<T, 256> crc_table()
+    {
+        std::array<T, 256> table{};
+        for (unsigned i = 0; i < 256; i++) {
+            T crc = static_cast<T>(i);
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc & 1) ? static_cast<T>((crc >> 1) ^ Poly) : static_cast<T>(crc >> 1);
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+}
+
+// 校验和策略。自定义校验和提供相同的成员即可。
+
+/** 无校验和 (TF_CKSUM_NONE) */
+struct None {
+    using type = uint8_t;
+    static constexpr bool enabled = false;
+    static constexpr type start() { return 0; }
+    static constexpr type add(type cksum, uint8_t) { return cksum; }
+    static constexpr type end(type cksum) { return cksum; }
+};
+
+/** 反向异或 (TF_CKSUM_XOR) */
+struct Xor {
+    using type = uint8_t;
+    static constexpr bool enabled = true;
+    static constexpr type start() { return 0; }
+    static constexpr type add(type cksum, uint8_t byte) { return static_cast<type>(cksum ^ byte); }
+    static constexpr type end(type cksum) { return static_cast<type>(~cksum); }
+};
+
+/** Dallas/Maxim CRC8 (TF_CKSUM_CRC8) */
+struct Crc8 {
+    using type = uint8_t;
+    static constexpr bool enabled = true;
+    static constexpr auto table = detail::crc_table<uint8_t, 0x8C>();
+    static constexpr type start() { return 0; }
+    static constexpr type add(type cksum, uint8_t byte) { return table[static_cast<uint8_t>(cksum ^ byte)]; }
+    static constexpr type end(type cksum) { return cksum; }
+};
+
+/** CRC16，多项式 0x8005 (TF_CKSUM_CRC16) */
+struct Crc16 {
+    using type = uint16_t;
+    static constexpr bool enabled = true;
+    static constexpr auto table = detail::crc_table<uint16_t, 0xA001>();
+    static constexpr type start() { return 0; }
+    static constexpr type add(type cksum, uint8_t byte) { return static_cast<type>((cksum >> 8) ^ table[(cksum ^ byte) & 0xff]); }
+    static constexpr type end(type cksum) { return cksum; }
+};
+
+/** CRC32，多项式 0xedb88320 (TF_CKSUM_CRC32) */
+struct Crc32 {
+    using type = uint32_t;
+    static constexpr bool enabled = true;
+    static constexpr auto table = detail::crc_table<uint32_t, 0xEDB88320u>();
+    static constexpr type start() { return 0xFFFFFFFFu; }
+    static constexpr type add(type cksum, uint8_t byte) { return table[(cksum ^ byte) & 0xff] ^ (cksum >> 8); }
+    static constexpr type end(type cksum) { return ~cksum; }
+};
+
+} // namespace checksum
+
+/** 作为 RxCap / TxCap 时表示缓冲区大小在构造时指定（从堆分配） */
+inline constexpr std::size_t dynamic_capacity = 0;
+
+/** 作为 Options::sof_byte 时表示是否使用 SOF 以及 SOF 的值在构造时指定 */
+inline constexpr int runtime_sof = -2;
+
+/** 用于发送/接收消息的数据结构，与 TF_Msg 相同 */
+template <class IdT, class LenT, class TypeT>
+struct BasicMsg {
+    IdT frame_id = 0;
+    bool is_response = false;
+    TypeT type = 0;
+    const uint8_t *data = nullptr;  //!< ID 监听器中为 nullptr 表示超时
+    LenT len = 0;
+    void *userdata = nullptr;
+    void *userdata2 = nullptr;
+};
+
+/** 所有引擎共有的公共用户数据 */
+struct EngineBase {
+    void *userdata = nullptr;
+    uint32_t usertag = 0;
+};
+
+namespace detail {
+    /** 编译期大小的缓冲区 */
+    template <std::size_t N>
+    class Buffer {
+    public:
+        explicit Buffer(std::size_t) noexcept {}
+        uint8_t *data() noexcept { return buf_; }
+        static constexpr std::size_t capacity() noexcept { return N; }
+    private:
+        uint8_t buf_[N];
+    };
+
+    /** 构造时指定大小的缓冲区 */
+    template <>
+    class Buffer<dynamic_capacity> {
+    public:
+        explicit Buffer(std::size_t n) : buf_(new uint8_t[n]), cap_(n) {}
+        uint8_t *data() noexcept { return buf_.get(); }
+        std::size_t capacity() const noexcept { return cap_; }
+    private:
+        std::unique_ptr<uint8_t[]> buf_;
+        std::size_t cap_;
+    };
+}
+
+/** 其余参数的默认值，对应 TF_Config.example.h。可以继承并覆盖部分成员。 */
+struct DefaultOptions {
+    static constexpr int sof_byte = 0x01;            //!< SOF 字节，负数 = 不使用 SOF (TF_USE_SOF_BYTE 0)，或 runtime_sof
+    static constexpr std::size_t max_id_listeners = 10;
+    static constexpr std::size_t max_type_listeners = 10;
+    static constexpr std::size_t max_generic_listeners = 5;
+    static constexpr unsigned parser_timeout_ticks = 10;
+    using ticks_type = uint16_t;
+
+    // 以下用于把多个特化放在同一个运行时接口之后（参见 tf_format.hpp），通常不需要修改
+
+    using base_type = EngineBase;   //!< 引擎的基类
+    using listener_self = void;     //!< 监听器收到的实例引用类型，void = 引擎本身
+    using msg_type = void;          //!< 消息类型，void = 与字段宽度一致的 BasicMsg
+
+    /** 错误报告（TF_Error），默认忽略 */
+    static void error(const char *message) { (void) message; }
+};
+
+template <class IdT, class LenT, class TypeT, class Checksum,
+          std::size_t RxCap, std::size_t TxCap, class Options = DefaultOptions>
+class Engine : public Options::base_type {
+    static_assert(std::is_unsigned_v<IdT> && (sizeof(IdT) == 1 || sizeof(IdT) == 2 || sizeof(IdT) == 4), "IdT 必须是 1、2 或 4 字节的无符号整数");
+    static_assert(std::is_unsigned_v<LenT> && (sizeof(LenT) == 1 || sizeof(LenT) == 2 || sizeof(LenT) == 4), "LenT 必须是 1、2 或 4 字节的无符号整数");
+    static_assert(std::is_unsigned_v<TypeT> && (sizeof(TypeT) == 1 || sizeof(TypeT) == 2 || sizeof(TypeT) == 4), "TypeT 必须是 1、2 或 4 字节的无符号整数");
+
+public:
+    using id_type = IdT;
+    using len_type = LenT;
+    using type_type = TypeT;
+    using cksum_type = typename Checksum::type;
+    using ticks_type = typename Options::ticks_type;
+
+    static constexpr bool has_sof = Options::sof_byte >= 0 || Options::sof_byte == runtime_sof; //!< 帧可能以 SOF 开头
+    static constexpr std::size_t cksum_size = Checksum::enabled ? sizeof(cksum_type) : 0;
+    static constexpr std::size_t head_size = (has_sof ? 1 : 0) + sizeof(IdT) + sizeof(LenT) + sizeof(TypeT) + cksum_size; //!< runtime_sof 时为上限
+
+    static_assert(TxCap == dynamic_capacity || TxCap >= head_size + cksum_size, "TxCap 必须至少能容纳帧头和校验和");
+
+    using Msg = std::conditional_t<std::is_void_v<typename Options::msg_type>,
+                                   BasicMsg<IdT, LenT, TypeT>, typename Options::msg_type>;
+    using Self = std::conditional_t<std::is_void_v<typename Options::listener_self>,
+                                    Engine, typename Options::listener_self>;
+
+    using Listener = Result (*)(Self &tf, Msg &msg);
+    using TimeoutListener = Result (*)(Self &tf);
+    using WriteFn = void (*)(Self &tf, const uint8_t *buff, std::size_t len);
+
+    /**
+     * @param peer - 自身的对方位
+     * @param write - 输出函数（TF_WriteImpl）
+     * @param user - userdata 的初始值
+     * @param rx_capacity - 接收缓冲区大小（仅当 RxCap 为 dynamic_capacity 时使用）
+     * @param tx_capacity - 发送缓冲区大小（仅当 TxCap 为 dynamic_capacity 时使用，至少 head_size + cksum_size）
+     * @param sof_byte - SOF 字节的值（仅当使用 SOF 时）；Options::sof_byte 为 runtime_sof 时，负数表示不使用 SOF
+     */
+    Engine(Peer peer, WriteFn write, void *user = nullptr,
+           std::size_t rx_capacity = RxCap, std::size_t tx_capacity = TxCap,
+           int sof_byte = Options::sof_byte)
+        : peer_bit_(peer), write_(write), sof_byte_(static_cast<uint8_t>(sof_byte)), sof_enabled_(sof_byte >= 0), data_(rx_capacity), sendbuf_(tx_capacity)
+    {
+        this->userdata = user;
+    }
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+
+    // --- 接收 ---
+
+    void accept(const uint8_t *buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++) {
+            accept_char(buffer[i]);
+        }
+    }
+
+    void accept_char(uint8_t c)
+    {
+        // 解析器超时 - 清除
+        if (parser_timeout_ticks_ >= Options::parser_timeout_ticks) {
+            if (state_ != State::Sof) {
+                reset_parser();
+                Options::error("解析器超时");
+            }
+        }
+        parser_timeout_ticks_ = 0;
+
+        // 先判断状态：只在帧开始时才需要查看是否使用 SOF
+        if (state_ == State::Sof && !use_sof()) begin_frame();
+
+        switch (state_) {
+            case State::Sof:
+                if (use_sof() && c == sof_byte_) begin_frame();
+                break;
+
+            case State::Id:
+                rx_cksum_ = Checksum::add(rx_cksum_, c);
+                if (collect(id_, c)) enter(State::Len);
+                break;
+
+            case State::Len:
+                rx_cksum_ = Checksum::add(rx_cksum_, c);
+                if (collect(len_, c)) enter(State::Type);
+                break;
+
+            case State::Type:
+                rx_cksum_ = Checksum::add(rx_cksum_, c);
+                if (collect(type_, c)) {
+                    if constexpr (Checksum::enabled) {
+                        enter(State::HeadCksum);
+                        ref_cksum_ = 0;
+                    } else {
+                        begin_data();
+                    }
+                }
+                break;
+
+            case State::HeadCksum:
+                if (collect(ref_cksum_, c)) {
+                    if (Checksum::end(rx_cksum_) != ref_cksum_) {
+                        Options::error("接收头部校验和不匹配");
+                        reset_parser();
+                        break;
+                    }
+                    begin_data();
+                }
+                break;
+
+            case State::Data:
+                if (discard_data_) {
+                    rxi_++;
+                } else {
+                    rx_cksum_ = Checksum::add(rx_cksum_, c);
+                    data_.data()[rxi_++] = c;
+                }
+
+                if (rxi_ == len_) {
+                    if constexpr (Checksum::enabled) {
+                        enter(State::DataCksum);
+                        ref_cksum_ = 0;
+                    } else {
+                        if (!discard_data_) complete_frame();
+                        reset_parser();
+                    }
+                }
+                break;
+
+            case State::DataCksum:
+                if (collect(ref_cksum_, c)) {
+                    if (!discard_data_) {
+                        if (Checksum::end(rx_cksum_) == ref_cksum_) {
+                            complete_frame();
+                        } else {
+                            Options::error("主体校验和不匹配");
+                        }
+                    }
+                    reset_parser();
+                }
+                break;
+        }
+    }
+
+    void reset_parser() noexcept { state_ = State::Sof; }
+
+    /** 定期调用，用于解析器超时和 ID 监听器超时 */
+    void tick()
+    {
+        if (parser_timeout_ticks_ < Options::parser_timeout_ticks) {
+            parser_timeout_ticks_++;
+        }
+
+        for (std::size_t i = 0; i < count_id_lst_; i++) {
+            IdListener &lst = id_listeners_[i];
+            if (!lst.fn || lst.timeout == 0) continue;
+            if (--lst.timeout == 0) {
+                Options::error("ID 监听器已过期");
+                IdListener expired = lst;
+                release_id_listener(i);
+                if (expired.fn_timeout) expired.fn_timeout(self());
+                notify_id_listener_cleanup(expired);
+            }
+        }
+    }
+
+    // --- 监听器 ---
+
+    bool add_id_listener(const Msg &msg, Listener cb, TimeoutListener ftimeout, ticks_type timeout)
+    {
+        for (std::size_t i = 0; i < Options::max_id_listeners; i++) {
+            IdListener &lst = id_listeners_[i];
+            if (lst.fn == nullptr) {
+                lst.fn = cb;
+                lst.fn_timeout = ftimeout;
+                lst.id = msg.frame_id;
+                lst.userdata = msg.userdata;
+                lst.userdata2 = msg.userdata2;
+                lst.timeout_max = lst.timeout = timeout;
+                if (i >= count_id_lst_) count_id_lst_ = i + 1;
+                return true;
+            }
+        }
+        Options::error("添加 ID 监听器失败");
+        return false;
+    }
+
+    bool add_type_listener(TypeT type, Listener cb)
+    {
+        for (std::size_t i = 0; i < Options::max_type_listeners; i++) {
+            TypeListener &lst = type_listeners_[i];
+            if (lst.fn == nullptr) {
+                lst.fn = cb;
+                lst.type = type;
+                if (i >= count_type_lst_) count_type_lst_ = i + 1;
+                return true;
+            }
+        }
+        Options::error("添加类型监听器失败");
+        return false;
+    }
+
+    bool add_generic_listener(Listener cb)
+    {
+        for (std::size_t i = 0; i < Options::max_generic_listeners; i++) {
+            if (generic_listeners_[i] == nullptr) {
+                generic_listeners_[i] = cb;
+                if (i >= count_generic_lst_) count_generic_lst_ = i + 1;
+                return true;
+            }
+        }
+        Options::error("添加通用监听器失败");
+        return false;
+    }
+
+    bool remove_id_listener(IdT frame_id)
+    {
+        for (std::size_t i = 0; i < count_id_lst_; i++) {
+            IdListener &lst = id_listeners_[i];
+            if (lst.fn != nullptr && lst.id == frame_id) {
+                IdListener removed = lst;
+                release_id_listener(i);
+                notify_id_listener_cleanup(removed);
+                return true;
+            }
+        }
+        Options::error("要移除的 ID 监听器未找到");
+        return false;
+    }
+
+    bool remove_type_listener(TypeT type)
+    {
+        for (std::size_t i = 0; i < count_type_lst_; i++) {
+            if (type_listeners_[i].fn != nullptr && type_listeners_[i].type == type) {
+                release_type_listener(i);
+                return true;
+            }
+        }
+        Options::error("要移除的类型监听器未找到");
+        return false;
+    }
+
+    bool remove_generic_listener(Listener cb)
+    {
+        for (std::size_t i = 0; i < count_generic_lst_; i++) {
+            if (generic_listeners_[i] == cb) {
+                release_generic_listener(i);
+                return true;
+            }
+        }
+        Options::error("要移除的通用监听器未找到");
+        return false;
+    }
+
+    bool renew_id_listener(IdT id)
+    {
+        for (std::size_t i = 0; i < count_id_lst_; i++) {
+            IdListener &lst = id_listeners_[i];
+            if (lst.fn != nullptr && lst.id == id) {
+                lst.timeout = lst.timeout_max;
+                return true;
+            }
+        }
+        Options::error("续期监听器：未找到");
+        return false;
+    }
+
+    // --- 发送 ---
+
+    bool send(Msg &msg) { return send_frame(msg, nullptr, nullptr, 0); }
+
+    bool send_simple(TypeT type, const uint8_t *data, LenT len)
+    {
+        Msg msg;
+        msg.type = type;
+        msg.data = data;
+        msg.len = len;
+        return send(msg);
+    }
+
+    bool query(Msg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout)
+    {
+        return send_frame(msg, listener, ftimeout, timeout);
+    }
+
+    bool query_simple(TypeT type, const uint8_t *data, LenT len, Listener listener, TimeoutListener ftimeout, ticks_type timeout)
+    {
+        Msg msg;
+        msg.type = type;
+        msg.data = data;
+        msg.len = len;
+        return query(msg, listener, ftimeout, timeout);
+    }
+
+    bool respond(Msg &msg)
+    {
+        msg.is_response = true;
+        return send(msg);
+    }
+
+    // 多部分帧：设置 msg.len 并将 msg.data 设为 nullptr，然后调用 multipart_payload() 和 multipart_close()
+
+    bool send_multipart(Msg &msg)
+    {
+        msg.data = nullptr;
+        return send(msg);
+    }
+
+    bool query_multipart(Msg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout)
+    {
+        msg.data = nullptr;
+        return query(msg, listener, ftimeout, timeout);
+    }
+
+    void respond_multipart(Msg &msg)
+    {
+        msg.data = nullptr;
+        respond(msg);
+    }
+
+    void multipart_payload(const uint8_t *buff, std::size_t length)
+    {
+        if (!tx_busy_) {
+            Options::error("多部分负载：没有正在发送的帧");
+            return;
+        }
+        if (length > tx_left_) {
+            Options::error("多部分负载超出帧头中的长度");
+            length = tx_left_;
+        }
+        tx_left_ -= length;
+        send_chunk(buff, length);
+    }
+
+    void multipart_close()
+    {
+        if (!tx_busy_) {
+            Options::error("多部分关闭：没有正在发送的帧");
+            return;
+        }
+        send_end();
+    }
+
+private:
+    enum class State {
+        Sof, Id, Len, HeadCksum, Type, Data, DataCksum
+    };
+
+    struct IdListener {
+        IdT id = 0;
+        Listener fn = nullptr;
+        TimeoutListener fn_timeout = nullptr;
+        ticks_type timeout = 0;
+        ticks_type timeout_max = 0;
+        void *userdata = nullptr;
+        void *userdata2 = nullptr;
+    };
+
+    struct TypeListener {
+        TypeT type = 0;
+        Listener fn = nullptr;
+    };
+
+    static constexpr IdT id_peerbit = static_cast<IdT>(IdT(1) << (sizeof(IdT) * 8 - 1));
+    static constexpr IdT id_mask = static_cast<IdT>(id_peerbit - 1);
+
+    // --- 解析器 ---
+
+    /** 从输入流逐字节收集多字节数字（大端），收集完整时返回 true */
+    template <class T>
+    bool collect(T &dest, uint8_t c) noexcept
+    {
+        dest = static_cast<T>((static_cast<uint64_t>(dest) << 8) | c);
+        return ++rxi_ == sizeof(T);
+    }
+
+    /** 值能否用 T 表示。Msg 的字段可能比线路上的字段宽（例如 tf_format.hpp 中的 AnyMsg） */
+    template <class T, class V>
+    static constexpr bool fits(V value) noexcept
+    {
+        if constexpr (sizeof(V) <= sizeof(T)) {
+            (void) value;
+            return true;
+        } else {
+            return value <= std::numeric_limits<T>::max();
+        }
+    }
+
+    /** 编译期确定时是常量，否则由构造参数决定 */
+    bool use_sof() const noexcept
+    {
+        if constexpr (Options::sof_byte == runtime_sof) {
+            return sof_enabled_;
+        } else {
+            return has_sof;
+        }
+    }
+
+    void enter(State state) noexcept
+    {
+        state_ = state;
+        rxi_ = 0;
+    }
+
+    void begin_frame() noexcept
+    {
+        rx_cksum_ = Checksum::start();
+        if (use_sof()) {
+            rx_cksum_ = Checksum::add(rx_cksum_, sof_byte_);
+        }
+        discard_data_ = false;
+        enter(State::Id);
+    }
+
+    void begin_data()
+    {
+        if (len_ == 0) {
+            complete_frame();
+            reset_parser();
+            return;
+        }
+
+        enter(State::Data);
+        rx_cksum_ = Checksum::start();
+
+        if (len_ > data_.capacity()) {
+            Options::error("接收负载过长");
+            discard_data_ = true;
+        }
+    }
+
+    void complete_frame()
+    {
+        Msg msg;
+        msg.frame_id = id_;
+        msg.is_response = false;
+        msg.type = type_;
+        msg.data = data_.data();
+        msg.len = len_;
+        handle_received(msg);
+    }
+
+    void handle_received(Msg &msg)
+    {
+        const auto frame_id = msg.frame_id;
+        const auto type = msg.type;
+        Result res;
+
+        for (std::size_t i = 0; i < count_id_lst_; i++) {
+            IdListener &lst = id_listeners_[i];
+            if (lst.fn && lst.id == frame_id) {
+                msg.userdata = lst.userdata;
+                msg.userdata2 = lst.userdata2;
+                res = lst.fn(self(), msg);
+                lst.userdata = msg.userdata;
+                lst.userdata2 = msg.userdata2;
+
+                if (res != Result::Next) {
+                    if (res == Result::Renew) {
+                        lst.timeout = lst.timeout_max;
+                    } else if (res == Result::Close) {
+                        release_id_listener(i);
+                    }
+                    return;
+                }
+            }
+        }
+
+        msg.userdata = nullptr;
+        msg.userdata2 = nullptr;
+
+        for (std::size_t i = 0; i < count_type_lst_; i++) {
+            TypeListener &lst = type_listeners_[i];
+            if (lst.fn && lst.type == type) {
+                res = lst.fn(self(), msg);
+                if (res != Result::Next) {
+                    if (res == Result::Close) release_type_listener(i);
+                    return;
+                }
+            }
+        }
+
+        for (std::size_t i = 0; i < count_generic_lst_; i++) {
+            if (generic_listeners_[i]) {
+                res = generic_listeners_[i](self(), msg);
+                if (res != Result::Next) {
+                    if (res == Result::Close) release_generic_listener(i);
+                    return;
+                }
+            }
+        }
+
+        Options::error("未处理的消息");
+    }
+
+    void release_id_listener(std::size_t i) noexcept
+    {
+        id_listeners_[i].fn = nullptr;
+        id_listeners_[i].fn_timeout = nullptr;
+        if (i == count_id_lst_ - 1) count_id_lst_--;
+    }
+
+    void release_type_listener(std::size_t i) noexcept
+    {
+        type_listeners_[i].fn = nullptr;
+        if (i == count_type_lst_ - 1) count_type_lst_--;
+    }
+
+    void release_generic_listener(std::size_t i) noexcept
+    {
+        generic_listeners_[i] = nullptr;
+        if (i == count_generic_lst_ - 1) count_generic_lst_--;
+    }
+
+    /** 让 ID 监听器释放 userdata（data == nullptr） */
+    void notify_id_listener_cleanup(const IdListener &lst)
+    {
+        if (lst.fn == nullptr) return;
+        if (lst.userdata != nullptr || lst.userdata2 != nullptr) {
+            Msg msg;
+            msg.frame_id = lst.id;
+            msg.userdata = lst.userdata;
+            msg.userdata2 = lst.userdata2;
+            lst.fn(self(), msg);
+        }
+    }
+
+    // --- 组合和发送 ---
+
+    /** 监听器和输出函数收到的实例引用 */
+    Self &self() noexcept { return *this; }
+
+    template <class T>
+    void write_num(T num, bool add_cksum) noexcept
+    {
+        for (int si = sizeof(T) - 1; si >= 0; si--) {
+            const uint8_t b = static_cast<uint8_t>(static_cast<uint64_t>(num) >> (si * 8));
+            sendbuf_.data()[tx_pos_++] = b;
+            if (add_cksum) tx_cksum_ = Checksum::add(tx_cksum_, b);
+        }
+    }
+
+    bool send_frame(Msg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout)
+    {
+        // 截断的长度会使帧头与发送的负载不一致，截断的类型或 ID 会发给错误的监听器
+        if (!fits<LenT>(msg.len) || !fits<TypeT>(msg.type) || (msg.is_response && !fits<IdT>(msg.frame_id))) {
+            Options::error("发送：长度、类型或 ID 超出帧格式的范围");
+            return false;
+        }
+
+        if (tx_busy_) {
+            Options::error("TF 已锁定用于 tx！");
+            return false;
+        }
+        tx_busy_ = true;
+
+        // 生成 ID
+        if (!msg.is_response) {
+            IdT id = static_cast<IdT>(next_id_++ & id_mask);
+            if (peer_bit_ == Peer::Master) id = static_cast<IdT>(id | id_peerbit);
+            msg.frame_id = id;
+        }
+
+        tx_pos_ = 0;
+        tx_cksum_ = Checksum::start();
+        if (use_sof()) {
+            sendbuf_.data()[tx_pos_++] = sof_byte_;
+            tx_cksum_ = Checksum::add(tx_cksum_, sof_byte_);
+        }
+        write_num(static_cast<IdT>(msg.frame_id), true);
+        write_num(static_cast<LenT>(msg.len), true);
+        write_num(static_cast<TypeT>(msg.type), true);
+        if constexpr (Checksum::enabled) {
+            write_num(Checksum::end(tx_cksum_), false);
+        }
+        tx_len_ = static_cast<LenT>(msg.len);
+        tx_left_ = msg.len;
+
+        if (listener && !add_id_listener(msg, listener, ftimeout, timeout)) {
+            tx_busy_ = false;
+            return false;
+        }
+
+        tx_cksum_ = Checksum::start();
+        if (msg.len == 0 || msg.data != nullptr) {
+            send_chunk(msg.data, msg.len);
+            send_end();
+        }
+        return true;
+    }
+
+    void send_chunk(const uint8_t *buff, std::size_t length)
+    {
+        std::size_t chunk;
+
+        while (length > 0) {
+            chunk = sendbuf_.capacity() - tx_pos_;
+            if (chunk > length) chunk = length;
+
+            if constexpr (Checksum::enabled) {
+                for (std::size_t i = 0; i < chunk; i++) {
+                    tx_cksum_ = Checksum::add(tx_cksum_, buff[i]);
+                }
+            }
+            std::memcpy(sendbuf_.data() + tx_pos_, buff, chunk);
+            tx_pos_ += chunk;
+            buff += chunk;
+            length -= chunk;
+
+            if (tx_pos_ == sendbuf_.capacity()) {
+                write_(self(), sendbuf_.data(), tx_pos_);
+                tx_pos_ = 0;
+            }
+        }
+    }
+
+    void send_end()
+    {
+        if constexpr (Checksum::enabled) {
+            if (tx_len_ > 0) {
+                if (sendbuf_.capacity() - tx_pos_ < sizeof(cksum_type)) {
+                    write_(self(), sendbuf_.data(), tx_pos_);
+                    tx_pos_ = 0;
+                }
+                write_num(Checksum::end(tx_cksum_), false);
+            }
+        }
+
+        write_(self(), sendbuf_.data(), tx_pos_);
+        tx_busy_ = false;
+    }
+
+    /* 自身状态 */
+    Peer peer_bit_;
+    WriteFn write_;
+    uint8_t sof_byte_;
+    bool sof_enabled_;
+
+    /* 解析器状态 */
+    State state_ = State::Sof;
+    ticks_type parser_timeout_ticks_ = 0;
+    IdT id_ = 0;
+    LenT len_ = 0;
+    TypeT type_ = 0;
+    std::size_t rxi_ = 0;
+    cksum_type rx_cksum_ = 0;
+    cksum_type ref_cksum_ = 0;
+    bool discard_data_ = false;
+    detail::Buffer<RxCap> data_;
+
+    /* 发送状态 */
+    IdT next_id_ = 0;
+    std::size_t tx_pos_ = 0;
+    LenT tx_len_ = 0;
+    std::size_t tx_left_ = 0;   //!< 多部分帧还可以发送的负载字节数
+    cksum_type tx_cksum_ = 0;
+    bool tx_busy_ = false;
+    detail::Buffer<TxCap> sendbuf_;
+
+    /* 监听器 */
+    IdListener id_listeners_[Options::max_id_listeners];
+    TypeListener type_listeners_[Options::max_type_listeners];
+    Listener generic_listeners_[Options::max_generic_listeners] = {};
+    std::size_t count_id_lst_ = 0;
+    std::size_t count_type_lst_ = 0;
+    std::size_t count_generic_lst_ = 0;
+};
+
+} // namespace tf
+
+#endif // TF_ENGINE_HPP
@@ -0,0 +1,134 @@
+#include "tf_format.hpp"
+
+namespace tf {
+
+namespace {
+
+/** 运行时接口背后的引擎的参数 */
+struct AnyOptions : DefaultOptions {
+    static constexpr int sof_byte = runtime_sof; // 只在每帧开始时判断一次，不值得为它加倍特化的数量
+    using base_type = AnyEngine;
+    using listener_self = AnyEngine;
+    using msg_type = AnyMsg;
+};
+
+/** 把运行时接口转发给一个特化（字段宽度不同的参数在这里转换） */
+template <class E>
+class EngineImpl final : public E {
+public:
+    using typename AnyEngine::Listener;
+    using typename AnyEngine::TimeoutListener;
+    using typename AnyEngine::WriteFn;
+    using ticks_type = AnyEngine::ticks_type;
+
+    EngineImpl(const Format &format, Peer peer, WriteFn write, void *userdata)
+        : E(peer, write, userdata, format.max_payload_rx, format.sendbuf_len,
+            format.use_sof ? format.sof_byte : -1), format_(format) {}
+
+    const Format &format() const noexcept override { return format_; }
+
+    void accept(const uint8_t *buffer, std::size_t count) override { E::accept(buffer, count); }
+    void reset_parser() noexcept override { E::reset_parser(); }
+    void tick() override { E::tick(); }
+
+    bool add_id_listener(const AnyMsg &msg, Listener cb, TimeoutListener ftimeout, ticks_type timeout) override
+    {
+        return E::add_id_listener(msg, cb, ftimeout, timeout);
+    }
+
+    bool add_type_listener(uint32_t type, Listener cb) override
+    {
+        return E::add_type_listener(static_cast<typename E::type_type>(type), cb);
+    }
+
+    bool add_generic_listener(Listener cb) override { return E::add_generic_listener(cb); }
+
+    bool remove_id_listener(uint32_t frame_id) override
+    {
+        return E::remove_id_listener(static_cast<typename E::id_type>(frame_id));
+    }
+
+    bool remove_type_listener(uint32_t type) override
+    {
+        return E::remove_type_listener(static_cast<typename E::type_type>(type));
+    }
+
+    bool remove_generic_listener(Listener cb) override { return E::remove_generic_listener(cb); }
+
+    bool renew_id_listener(uint32_t id) override
+    {
+        return E::renew_id_listener(static_cast<typename E::id_type>(id));
+    }
+
+    bool send(AnyMsg &msg) override { return E::send(msg); }
+
+    bool query(AnyMsg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout) override
+    {
+        return E::query(msg, listener, ftimeout, timeout);
+    }
+
+    bool respond(AnyMsg &msg) override { return E::respond(msg); }
+    bool send_multipart(AnyMsg &msg) override { return E::send_multipart(msg); }
+
+    bool query_multipart(AnyMsg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout) override
+    {
+        return E::query_multipart(msg, listener, ftimeout, timeout);
+    }
+
+    void respond_multipart(AnyMsg &msg) override { E::respond_multipart(msg); }
+    void multipart_payload(const uint8_t *buff, std::size_t length) override { E::multipart_payload(buff, length); }
+    void multipart_close() override { E::multipart_close(); }
+
+private:
+    Format format_;
+};
+
+// 以下辅助函数把运行时的值转换为类型，对每个组合实例化一个特化
+
+template <class F>
+void with_width(uint8_t bytes, F &&fn)
+{
+    switch (bytes) {
+        case 1: fn(uint8_t{}); break;
+        case 2: fn(uint16_t{}); break;
+        case 4: fn(uint32_t{}); break;
+        default: break;
+    }
+}
+
+template <class F>
+void with_checksum(ChecksumKind kind, F &&fn)
+{
+    switch (kind) {
+        case ChecksumKind::None: fn(checksum::None{}); break;
+        case ChecksumKind::Xor: fn(checksum::Xor{}); break;
+        case ChecksumKind::Crc8: fn(checksum::Crc8{}); break;
+        case ChecksumKind::Crc16: fn(checksum::Crc16{}); break;
+        case ChecksumKind::Crc32: fn(checksum::Crc32{}); break;
+    }
+}
+
+} // namespace
+
+std::unique_ptr<AnyEngine> make_engine(const Format &format, Peer peer, AnyEngine::WriteFn write, void *userdata)
+{
+    std::unique_ptr<AnyEngine> engine;
+
+    with_width(format.id_bytes, [&](auto id) {
+    with_width(format.len_bytes, [&](auto len) {
+    with_width(format.type_bytes, [&](auto type) {
+    with_checksum(format.checksum, [&](auto cksum) {
+        using E = Engine<decltype(id), decltype(len), decltype(type), decltype(cksum),
+                         dynamic_capacity, dynamic_capacity, AnyOptions>;
+
+        if (format.sendbuf_len < E::head_size + E::cksum_size) return;
+        engine = std::make_unique<EngineImpl<E>>(format, peer, write, userdata);
+    });
+    });
+    });
+    });
+
+    return engine;
+}
+
+} // namespace tf
@@ -0,0 +1,108 @@
+#ifndef TF_FORMAT_HPP
+#define TF_FORMAT_HPP
+
+/**
+ * 运行时选择帧格式，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 在运行时加载的驱动（插件）无法为每个设备系列重新编译 TinyFrame.c。tf::make_engine() 根据格式描述
+ * （字段宽度、SOF、校验和、缓冲区大小）创建一个实例，它背后是 tf_format.cpp 中预先编译的
+ * tf::Engine 特化之一（按字段宽度和校验和，共 135 个）：选择只在创建时进行一次，之后每次 accept()
+ * 调用只有一次虚函数调用，逐字节的解析循环中除了帧开始时是否有 SOF 之外没有与格式有关的分支。
+ *
+ *     tf::Format fmt;
+ *     fmt.id_bytes = 2;
+ *     fmt.checksum = tf::ChecksumKind::Crc32;
+ *     auto dev = tf::make_engine(fmt, tf::Peer::Master, write_fn);
+ *     dev->add_type_listener(0x22, on_status);
+ *     dev->accept(rx_bytes, n);
+ *
+ * 所有格式共用同一个消息类型 tf::AnyMsg（字段为 32 位）；发送时长度、类型或 ID 超出格式中的宽度则返回 false。
+ * 监听器数量等其余参数使用 tf::DefaultOptions 中的值。
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "tf_engine.hpp"
+
+namespace tf {
+
+/** 校验和类型，对应 TF_CKSUM_* */
+enum class ChecksumKind {
+    None,
+    Xor,
+    Crc8,
+    Crc16,
+    Crc32,
+};
+
+/** 帧格式描述，默认值对应 TF_Config.example.h */
+struct Format {
+    uint8_t id_bytes = 1;       //!< 1、2 或 4
+    uint8_t len_bytes = 2;      //!< 1、2 或 4
+    uint8_t type_bytes = 1;     //!< 1、2 或 4
+    ChecksumKind checksum = ChecksumKind::Crc16;
+    bool use_sof = true;
+    uint8_t sof_byte = 0x01;
+    std::size_t max_payload_rx = 1024;  //!< 接收缓冲区大小 (TF_MAX_PAYLOAD_RX)
+    std::size_t sendbuf_len = 128;      //!< 发送缓冲区大小 (TF_SENDBUF_LEN)
+};
+
+/** 所有格式共用的消息类型 */
+using AnyMsg = BasicMsg<uint32_t, uint32_t, uint32_t>;
+
+/** 任意格式的引擎的运行时接口，由 make_engine() 创建 */
+class AnyEngine : public EngineBase {
+public:
+    using Listener = Result (*)(AnyEngine &tf, AnyMsg &msg);
+    using TimeoutListener = Result (*)(AnyEngine &tf);
+    using WriteFn = void (*)(AnyEngine &tf, const uint8_t *buff, std::size_t len);
+    using ticks_type = DefaultOptions::ticks_type;
+
+    virtual ~AnyEngine() = default;
+
+    /** 创建时使用的格式 */
+    virtual const Format &format() const noexcept = 0;
+
+    // --- 接收 ---
+    virtual void accept(const uint8_t *buffer, std::size_t count) = 0;
+    void accept_char(uint8_t c) { accept(&c, 1); }
+    virtual void reset_parser() noexcept = 0;
+    virtual void tick() = 0;
+
+    // --- 监听器 ---
+    virtual bool add_id_listener(const AnyMsg &msg, Listener cb, TimeoutListener ftimeout, ticks_type timeout) = 0;
+    virtual bool add_type_listener(uint32_t type, Listener cb) = 0;
+    virtual bool add_generic_listener(Listener cb) = 0;
+    virtual bool remove_id_listener(uint32_t frame_id) = 0;
+    virtual bool remove_type_listener(uint32_t type) = 0;
+    virtual bool remove_generic_listener(Listener cb) = 0;
+    virtual bool renew_id_listener(uint32_t id) = 0;
+
+    // --- 发送 ---
+    virtual bool send(AnyMsg &msg) = 0;
+    virtual bool query(AnyMsg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout) = 0;
+    virtual bool respond(AnyMsg &msg) = 0;
+    virtual bool send_multipart(AnyMsg &msg) = 0;
+    virtual bool query_multipart(AnyMsg &msg, Listener listener, TimeoutListener ftimeout, ticks_type timeout) = 0;
+    virtual void respond_multipart(AnyMsg &msg) = 0;
+    virtual void multipart_payload(const uint8_t *buff, std::size_t length) = 0;
+    virtual void multipart_close() = 0;
+};
+
+/**
+ * 创建给定格式的实例。
+ *
+ * @param format - 帧格式
+ * @param peer - 自身的对方位
+ * @param write - 输出函数
+ * @param userdata - userdata 的初始值
+ * @return 实例；格式不受支持（宽度不是 1/2/4，或发送缓冲区放不下帧头）时返回 nullptr
+ */
+std::unique_ptr<AnyEngine> make_engine(const Format &format, Peer peer, AnyEngine::WriteFn write, void *userdata = nullptr);
+
+} // namespace tf
+
+#endif // TF_FORMAT_HPP
@@ -0,0 +1,100 @@
+#ifndef TF_SHM_LAYOUT_H
+#define TF_SHM_LAYOUT_H
+
+/**
+ * 共享内存统计段的布局，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 由 tf_shmstats.c（在应用中）写入，由 tools/tf_top（或其他监控程序）只读映射。
+ * 这个头文件不依赖 TinyFrame.h 和 TF_Config.h，因此监控程序不必与应用使用相同的配置。
+ *
+ * 段由一个文件头和 capacity 个槽组成，每个槽对应一个实例。所有字段用宽松的原子操作读写；
+ * 各个字段分别一致，槽整体不是原子的快照（对于计算速率已经足够）。布局改变时 version 增加，
+ * 读者必须检查 magic、version、header_size 和 slot_size。
+ */
+
+#include <stdint.h>
+
+/** 文件头中的魔数 */
+#define TF_SHM_MAGIC 0x53544654u
+/** 布局版本 */
+#define TF_SHM_VERSION 1
+
+/** 每个槽中保存的查询类型延迟摘要的数量 */
+#define TF_SHM_LATENCY_TYPES 4
+/** 槽的标签的长度（包括结尾的 0） */
+#define TF_SHM_LABEL_LEN 32
+
+/** 段的文件头 */
+typedef struct TF_ShmHeader_ {
+    uint32_t magic;         //!< TF_SHM_MAGIC
+    uint32_t version;       //!< TF_SHM_VERSION
+    uint32_t header_size;   //!< sizeof(TF_ShmHeader)
+    uint32_t slot_size;     //!< sizeof(TF_ShmSlot)
+    uint32_t capacity;      //!< 槽的数量
+    uint32_t time_unit_ns;  //!< 延迟的单位（纳秒），0 表示未知
+} TF_ShmHeader;
+
+/** 一个查询类型的延迟摘要 */
+typedef struct TF_ShmLatency_ {
+    uint32_t type;
+    uint32_t count;
+    uint32_t timeouts;
+    uint32_t reserved;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+} TF_ShmLatency;
+
+/** 槽的状态 */
+enum {
+    TF_SHM_SLOT_FREE = 0,
+    TF_SHM_SLOT_CLAIMED = 1,    //!< 正在初始化
+    TF_SHM_SLOT_ACTIVE = 2,
+};
+
+/** 一个实例的统计 */
+typedef struct TF_ShmSlot_ {
+    uint32_t state;         //!< TF_SHM_SLOT_*
+    uint32_t pid;           //!< 拥有者进程（用于发现已退出的进程留下的槽）
+    uint32_t usertag;       //!< 实例的 usertag
+    uint32_t reserved;
+    char label[TF_SHM_LABEL_LEN];
+    uint64_t seq;           //!< 发布次数
+    uint64_t updated_ns;    //!< 最近一次发布的时间（CLOCK_MONOTONIC，纳秒）
+
+    // 计数器（TF_Stats）
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t rx_discarded_bytes;
+    uint32_t rx_dropped;
+    uint32_t head_cksum_errors;
+    uint32_t body_cksum_errors;
+    uint32_t parser_timeouts;
+    uint32_t oversize_payloads;
+    uint32_t listener_hits;
+    uint32_t listener_misses;
+    uint32_t tx_frames;
+    uint32_t tx_bytes;
+    uint32_t expired_listeners;
+
+    // 当前值
+    uint32_t rx_queued;             //!< 接收队列中等待分发的帧
+    uint32_t id_listeners_inflight; //!< ID 监听器的占用
+    uint32_t id_listeners_peak;
+    uint32_t id_listeners_max;      //!< TF_MAX_ID_LST
+
+    uint32_t latency_count;         //!< latency 中有效的条目数量
+    TF_ShmLatency latency[TF_SHM_LATENCY_TYPES];
+} TF_ShmSlot;
+
+/** 第 i 个槽 */
+#define TF_SHM_SLOT(hdr, i) \
+    ((TF_ShmSlot *) ((uint8_t *) (hdr) + (hdr)->header_size + (size_t) (i) * (hdr)->slot_size))
+
+/** 段的大小 */
+#define TF_SHM_SIZE(capacity) (sizeof(TF_ShmHeader) + (size_t) (capacity) * sizeof(TF_ShmSlot))
+
+#endif // TF_SHM_LAYOUT_H
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tf_shmstats.h"
+
+#define SHM_STORE(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+
+/** 等待另一个进程完成段的初始化（magic 最后写入） */
+static bool shm_wait_ready(int fd, TF_ShmHeader **hdr_out, size_t *size_out)
+{
+    struct stat sb;
+    TF_ShmHeader *hdr;
+    uint32_t tries;
+
+    for (tries = 0; tries < 100; tries++) {
+        if (fstat(fd, &sb) != 0) return false;
+        if ((size_t) sb.st_size >= sizeof(TF_ShmHeader)) {
+            hdr = mmap(NULL, (size_t) sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (hdr == MAP_FAILED) return false;
+            if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) == TF_SHM_MAGIC) {
+                *hdr_out = hdr;
+                *size_out = (size_t) sb.st_size;
+                return true;
+            }
+            munmap(hdr, (size_t) sb.st_size);
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+TF_ShmStats *TF_ShmStatsOpen(const char *name, uint32_t capacity, uint32_t time_unit_ns)
+{
+    TF_ShmStats *shm;
+    TF_ShmHeader *hdr = NULL;
+    size_t size;
+    int fd;
+
+    if (capacity == 0) return NULL;
+    shm = malloc(sizeof(TF_ShmStats));
+    if (shm == NULL) return NULL;
+
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+        // 新的段：设置大小，填写文件头，最后写入 magic
+        size = TF_SHM_SIZE(capacity);
+        if (ftruncate(fd, (off_t) size) != 0) goto fail_unlink;
+        hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (hdr == MAP_FAILED) goto fail_unlink;
+
+        hdr->version = TF_SHM_VERSION;
+        hdr->header_size = sizeof(TF_ShmHeader);
+        hdr->slot_size = sizeof(TF_ShmSlot);
+        hdr->capacity = capacity;
+        hdr->time_unit_ns = time_unit_ns;
+        __atomic_store_n(&hdr->magic, TF_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+    else if (errno == EEXIST) {
+        fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) goto fail;
+        if (!shm_wait_ready(fd, &hdr, &size)) goto fail_close;
+
+        if (hdr->version != TF_SHM_VERSION || hdr->header_size != sizeof(TF_ShmHeader) ||
+            hdr->slot_size != sizeof(TF_ShmSlot) || size < TF_SHM_SIZE(hdr->capacity)) {
+            munmap(hdr, size);
+            goto fail_close;
+        }
+    }
+    else {
+        goto fail;
+    }
+
+    close(fd);
+    shm->hdr = hdr;
+    shm->size = size;
+    return shm;
+
+fail_unlink:
+    shm_unlink(name);
+fail_close:
+    close(fd);
+fail:
+    free(shm);
+    return NULL;
+}
+
+void TF_ShmStatsClose(TF_ShmStats *shm)
+{
+    if (shm == NULL) return;
+    munmap(shm->hdr, shm->size);
+    free(shm);
+}
+
+void TF_ShmStatsUnlink(const char *name)
+{
+    shm_unlink(name);
+}
+
+int32_t TF_ShmStatsAttach(TF_ShmStats *shm, TinyFrame *tf, const char *label)
+{
+    uint32_t i;
+    uint32_t expected;
+    TF_ShmSlot *slot;
+
+    for (i = 0; i < shm->hdr->capacity; i++) {
+        slot = TF_SHM_SLOT(shm->hdr, i);
+        expected = TF_SHM_SLOT_FREE;
+        if (!__atomic_compare_exchange_n(&slot->state, &expected, TF_SHM_SLOT_CLAIMED,
+                                         false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        // 清除上一个拥有者留下的值（保留 state）
+        memset((uint8_t *) slot + sizeof(slot->state), 0, sizeof(TF_ShmSlot) - sizeof(slot->state));
+        slot->pid = (uint32_t) getpid();
+        slot->usertag = tf->usertag;
+        strncpy(slot->label, label ? label : "", TF_SHM_LABEL_LEN - 1);
+        slot->id_listeners_max = TF_MAX_ID_LST;
+
+        __atomic_store_n(&slot->state, TF_SHM_SLOT_ACTIVE, __ATOMIC_RELEASE);
+        return (int32_t) i;
+    }
+    return -1;
+}
+
+void TF_ShmStatsDetach(TF_ShmStats *shm, int32_t slot)
+{
+    if (slot < 0 || (uint32_t) slot >= shm->hdr->capacity) return;
+    __atomic_store_n(&TF_SHM_SLOT(shm->hdr, slot)->state, TF_SHM_SLOT_FREE, __ATOMIC_RELEASE);
+}
+
+void TF_ShmStatsPublish(TF_ShmStats *shm, int32_t slot_index, TinyFrame *tf)
+{
+    TF_ShmSlot *slot;
+    TF_Stats st;
+    struct timespec now;
+
+    if (slot_index < 0 || (uint32_t) slot_index >= shm->hdr->capacity) return;
+    slot = TF_SHM_SLOT(shm->hdr, slot_index);
+
+    TF_GetStats(tf, &st);
+
+    SHM_STORE(slot->rx_frames, st.rx_frames);
+    SHM_STORE(slot->rx_bytes, st.rx_bytes);
+    SHM_STORE(slot->rx_discarded_bytes, st.rx_discarded_bytes);
+    SHM_STORE(slot->rx_dropped, st.rx_dropped);
+    SHM_STORE(slot->head_cksum_errors, st.head_cksum_errors);
+    SHM_STORE(slot->body_cksum_errors, st.body_cksum_errors);
+    SHM_STORE(slot->parser_timeouts, st.parser_timeouts);
+    SHM_STORE(slot->oversize_payloads, st.oversize_payloads);
+    SHM_STORE(slot->listener_hits, st.listener_hits);
+    SHM_STORE(slot->listener_misses, st.listener_misses);
+    SHM_STORE(slot->tx_frames, st.tx_frames);
+    SHM_STORE(slot->tx_bytes, st.tx_bytes);
+    SHM_STORE(slot->expired_listeners, st.expired_listeners);
+    SHM_STORE(slot->rx_queued, st.rx_queued);
+    SHM_STORE(slot->id_listeners_inflight, st.id_listeners_inflight);
+    SHM_STORE(slot->id_listeners_peak, st.id_listeners_peak);
+
+#if TF_USE_LATENCY
+    {
+        TF_TYPE types[TF_SHM_LATENCY_TYPES];
+        TF_LatencySummary sum;
+        uint32_t i, n;
+
+        n = TF_LatencyTypes(tf, types, TF_SHM_LATENCY_TYPES);
+        for (i = 0; i < n; i++) {
+            TF_GetLatency(tf, types[i], &sum);
+            SHM_STORE(slot->latency[i].type, (uint32_t) types[i]);
+            SHM_STORE(slot->latency[i].count, sum.count);
+            SHM_STORE(slot->latency[i].timeouts, sum.timeouts);
+            SHM_STORE(slot->latency[i].p50, sum.p50);
+            SHM_STORE(slot->latency[i].p99, sum.p99);
+            SHM_STORE(slot->latency[i].p999, sum.p999);
+            SHM_STORE(slot->latency[i].max, sum.max);
+        }
+        SHM_STORE(slot->latency_count, n);
+    }
+#endif
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    SHM_STORE(slot->updated_ns, (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec);
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,89 @@
+#ifndef TF_SHMSTATS_H
+#define TF_SHMSTATS_H
+
+/**
+ * 共享内存统计导出，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * 把实例的统计（TF_GetStats()）、接收队列深度、ID 监听器的占用和查询延迟摘要（如果启用了
+ * TF_USE_LATENCY）发布到一个命名的 POSIX 共享内存段（布局见 tf_shm_layout.h），外部的监控程序
+ * （tools/tf_top）只读地映射它并显示实时的速率，不需要访问进程或增加 RPC。
+ *
+ *     TF_ShmStats *shm = TF_ShmStatsOpen("/tinyframe", 4096, 1);
+ *     int32_t slot = TF_ShmStatsAttach(shm, tf, "uart3");
+ *     ...
+ *     // 例如每秒一次，在调用 TF_Tick() 的线程中
+ *     TF_ShmStatsPublish(shm, slot, tf);
+ *
+ * 计数器本身仍在实例中更新（收发路径上没有额外的开销），发布时用宽松的原子操作复制到段中。
+ * 需要 TF_USE_STATS 和 POSIX 共享内存（shm_open）。
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "TinyFrame.h"
+#include "tf_shm_layout.h"
+
+#if !TF_USE_STATS
+    #error tf_shmstats 需要 TF_USE_STATS
+#endif
+
+/** 映射的段 */
+typedef struct TF_ShmStats_ {
+    TF_ShmHeader *hdr;
+    size_t size;
+} TF_ShmStats;
+
+/**
+ * 创建或打开统计段。多个进程可以共用同一个段（槽用原子操作分配）。
+ *
+ * @param name - 段的名称，以 '/' 开头，例如 "/tinyframe"
+ * @param capacity - 槽的数量（创建时使用；打开已有的段时使用其中的值）
+ * @param time_unit_ns - TF_Timestamp() 的单位（纳秒），用于显示延迟；0 表示未知
+ * @return 段，失败时返回 NULL（已有的段布局不兼容时也失败）
+ */
+TF_ShmStats *TF_ShmStatsOpen(const char *name, uint32_t capacity, uint32_t time_unit_ns);
+
+/**
+ * 解除映射（段本身保留，供监控程序继续读取）
+ *
+ * @param shm - 段
+ */
+void TF_ShmStatsClose(TF_ShmStats *shm);
+
+/**
+ * 删除段的名称（已映射的进程不受影响）
+ *
+ * @param name - 段的名称
+ */
+void TF_ShmStatsUnlink(const char *name);
+
+/**
+ * 为实例分配一个槽
+ *
+ * @param shm - 段
+ * @param tf - 实例
+ * @param label - 显示的名称（截断到 TF_SHM_LABEL_LEN - 1 字节）
+ * @return 槽的编号，段已满时返回 -1
+ */
+int32_t TF_ShmStatsAttach(TF_ShmStats *shm, TinyFrame *tf, const char *label);
+
+/**
+ * 释放槽
+ *
+ * @param shm - 段
+ * @param slot - TF_ShmStatsAttach() 返回的编号
+ */
+void TF_ShmStatsDetach(TF_ShmStats *shm, int32_t slot);
+
+/**
+ * 把实例当前的统计发布到槽中。可以在任何线程中调用，但同一个槽只能有一个发布者。
+ *
+ * @param shm - 段
+ * @param slot - 槽的编号
+ * @param tf - 实例
+ */
+void TF_ShmStatsPublish(TF_ShmStats *shm, int32_t slot, TinyFrame *tf);
+
+#endif // TF_SHMSTATS_H
@@ -0,0 +1,235 @@
+#ifndef TINYFRAME_HPP
+#define TINYFRAME_HPP
+
+/**
+ * C++17 包装器，TinyFrame 工具集合的一部分
+ *
+ * MIT 许可证。
+ *
+ * tf::Frame<Handler> 拥有一个 TinyFrame 实例（RAII，可移动）和一个处理器对象。
+ * 监听器是处理器的成员函数（或普通函数），作为模板参数注册：
+ *
+ *     struct Device {
+ *         int count = 0;
+ *         TF_Result on_status(tf::Frame<Device> &f, tf::Message msg) {
+ *             count++;
+ *             f.respond(msg, msg.payload());
+ *             return TF_STAY;
+ *         }
+ *     };
+ *
+ *     tf::Frame<Device> f(TF_SLAVE);
+ *     f.add_type_listener<&Device::on_status>(0x10);
+ *
+ * 每个监听器由一个静态的转接函数实现，通过 tf->userdata 找到 Frame，再直接调用成员函数指针
+ * （编译期常量，可以内联）。状态保存在处理器中，因此不需要 std::function 也不需要分配内存。
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+#include "TinyFrame.h"
+
+namespace tf {
+
+/** 只读字节序列（指针 + 长度），在 C++20 中可以与 std::span 互相转换 */
+class Bytes {
+public:
+    constexpr Bytes() noexcept = default;
+    constexpr Bytes(const uint8_t *data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+    template <std::size_t N>
+    constexpr Bytes(const uint8_t (&arr)[N]) noexcept : data_(arr), size_(N) {}
+
+#if __cpp_lib_span >= 202002L
+    template <std::size_t E>
+    constexpr Bytes(std::span<const uint8_t, E> s) noexcept : data_(s.data()), size_(s.size()) {}
+    template <std::size_t E>
+    constexpr Bytes(std::span<uint8_t, E> s) noexcept : data_(s.data()), size_(s.size()) {}
+
+    constexpr operator std::span<const uint8_t>() const noexcept { return {data_, size_}; }
+#endif
+
+    constexpr const uint8_t *data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr const uint8_t *begin() const noexcept { return data_; }
+    constexpr const uint8_t *end() const noexcept { return data_ + size_; }
+    constexpr uint8_t operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+    const uint8_t *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+/** 传递给监听器的消息视图，负载只在回调期间有效 */
+class Message {
+public:
+    explicit Message(TF_Msg &msg) noexcept : msg_(&msg) {}
+
+    TF_ID id() const noexcept { return msg_->frame_id; }
+    TF_TYPE type() const noexcept { return msg_->type; }
+    Bytes payload() const noexcept { return {msg_->data, msg_->len}; }
+    void *userdata() const noexcept { return msg_->userdata; }
+
+    /** ID 监听器超时（或被移除）时为 true，参见 TF_Msg::data */
+    bool timed_out() const noexcept { return msg_->data == nullptr; }
+
+#if TF_USE_RX_TIMESTAMP
+    /** 帧的第一个字节和校验和通过的时间，参见 TF_Msg::rx_start */
+    uint64_t rx_start() const noexcept { return msg_->rx_start; }
+    uint64_t rx_end() const noexcept { return msg_->rx_end; }
+#endif
+
+    TF_Msg &raw() noexcept { return *msg_; }
+    const TF_Msg &raw() const noexcept { return *msg_; }
+
+private:
+    TF_Msg *msg_;
+};
+
+/** 没有状态的默认处理器 */
+struct NoHandler {};
+
+template <class Handler = NoHandler>
+class Frame {
+public:
+    /**
+     * 创建实例，其余参数传递给处理器的构造函数
+     *
+     * @throws std::bad_alloc - TF_Init() 失败；处理器的构造函数抛出的异常原样传出
+     */
+    template <class... Args>
+    explicit Frame(TF_Peer peer, Args &&... args)
+        : handler_(std::forward<Args>(args)...), tf_(TF_Init(peer))
+    {
+        if (tf_ == nullptr) throw std::bad_alloc();
+        tf_->userdata = this;
+    }
+
+    ~Frame() { TF_DeInit(tf_); }
+
+    Frame(const Frame &) = delete;
+    Frame &operator=(const Frame &) = delete;
+
+    Frame(Frame &&other) noexcept
+        : handler_(std::move(other.handler_)), tf_(std::exchange(other.tf_, nullptr))
+    {
+        if (tf_ != nullptr) tf_->userdata = this;
+    }
+
+    Frame &operator=(Frame &&other) noexcept
+    {
+        if (this != &other) {
+            TF_DeInit(tf_);
+            tf_ = std::exchange(other.tf_, nullptr);
+            handler_ = std::move(other.handler_);
+            if (tf_ != nullptr) tf_->userdata = this;
+        }
+        return *this;
+    }
+
+    /** 底层实例，用于调用没有包装的 C 函数（不要修改 userdata） */
+    TinyFrame *get() const noexcept { return tf_; }
+
+    Handler &handler() noexcept { return handler_; }
+    const Handler &handler() const noexcept { return handler_; }
+
+    /** 从 Frame 使用的 TinyFrame 实例找回 Frame（例如在 TF_WriteImpl() 中） */
+    static Frame &from(TinyFrame *tf) noexcept { return *static_cast<Frame *>(tf->userdata); }
+
+    // --- 接收 ---
+
+    void accept(Bytes bytes) { TF_Accept(tf_, bytes.data(), static_cast<uint32_t>(bytes.size())); }
+    void tick() { TF_Tick(tf_); }
+    void reset_parser() { TF_ResetParser(tf_); }
+
+    // --- 发送 ---
+
+    bool send(TF_TYPE type, Bytes payload = {})
+    {
+        return TF_SendSimple(tf_, type, payload.data(), static_cast<TF_LEN>(payload.size()));
+    }
+
+    bool respond(Message &msg, Bytes payload = {})
+    {
+        TF_Msg reply = msg.raw();
+        reply.data = payload.data();
+        reply.len = static_cast<TF_LEN>(payload.size());
+        return TF_Respond(tf_, &reply);
+    }
+
+    /**
+     * 发送查询，响应（或超时）由 Fn 处理；ctx 通过 Message::userdata() 传递给 Fn。
+     * ctx 可以为 nullptr，超时仍然会通知 Fn。
+     */
+    template <auto Fn>
+    bool query(TF_TYPE type, Bytes payload, TF_TICKS timeout, void *ctx = nullptr)
+    {
+        TF_Msg msg;
+        TF_ClearMsg(&msg);
+        msg.type = type;
+        msg.data = payload.data();
+        msg.len = static_cast<TF_LEN>(payload.size());
+        // userdata 为 NULL 时库不会通知超时，没有 ctx 的查询用 no_ctx_ 代替
+        msg.userdata = (ctx != nullptr) ? ctx : &no_ctx_;
+        return TF_Query(tf_, &msg, &query_thunk<Fn>, nullptr, timeout);
+    }
+
+    // --- 监听器 ---
+    // Fn 可以是 TF_Result (Handler::*)(Frame &, Message)，
+    // 也可以是 TF_Result (*)(Frame &, Message)（包括无捕获的 lambda 转换的函数指针）。
+
+    template <auto Fn>
+    bool add_type_listener(TF_TYPE type) { return TF_AddTypeListener(tf_, type, &thunk<Fn>); }
+
+    bool remove_type_listener(TF_TYPE type) { return TF_RemoveTypeListener(tf_, type); }
+
+    template <auto Fn>
+    bool add_generic_listener() { return TF_AddGenericListener(tf_, &thunk<Fn>); }
+
+    template <auto Fn>
+    bool remove_generic_listener() { return TF_RemoveGenericListener(tf_, &thunk<Fn>); }
+
+    bool remove_id_listener(TF_ID id) { return TF_RemoveIdListener(tf_, id); }
+
+private:
+    /** 每个 Fn 一个 C 回调，编译期确定调用目标 */
+    template <auto Fn>
+    static TF_Result thunk(TinyFrame *tf, TF_Msg *msg)
+    {
+        Frame &self = from(tf);
+        if constexpr (std::is_member_function_pointer_v<decltype(Fn)>) {
+            return (self.handler_.*Fn)(self, Message(*msg));
+        } else {
+            return Fn(self, Message(*msg));
+        }
+    }
+
+    /** 查询的回调：把 no_ctx_ 换回 nullptr 再交给 Fn，之后换回来，以便监听器保留时仍能收到超时 */
+    template <auto Fn>
+    static TF_Result query_thunk(TinyFrame *tf, TF_Msg *msg)
+    {
+        const bool no_ctx = (msg->userdata == &no_ctx_);
+        if (no_ctx) msg->userdata = nullptr;
+        TF_Result rv = thunk<Fn>(tf, msg);
+        if (no_ctx && msg->userdata == nullptr) msg->userdata = &no_ctx_;
+        return rv;
+    }
+
+    /** 没有 ctx 的查询使用的非空 userdata */
+    static inline char no_ctx_ = 0;
+
+    // 处理器先构造：它的构造函数抛出异常时还没有创建实例，不会泄漏
+    Handler handler_;
+    TinyFrame *tf_;
+};
+
+} // namespace tf
+
+#endif // TINYFRAME_HPP